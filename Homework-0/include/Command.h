@@ -1,5 +1,6 @@
 #pragma once
 #include "Global.h"
+#include "utils.h"
 
 // The function that initializes the database and runs it, for as long as the program runs
-void RunDB(char* file_path, int m, int bucket_size, float LOAD_THRESHOLD);
+void RunDB(Args* args, float LOAD_THRESHOLD);
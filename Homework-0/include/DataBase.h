@@ -2,27 +2,54 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include "Global.h"
+#include "HashTable.h"
 
 typedef struct database* DataBase; 
 
+// A DataBase can be shared by several threads. Any number of them may query it
+// (print a voter, exists, the counters, the zipcodes) and change it (insert, mark
+// voted) at once; only delete and save wait for the changes and the voters being
+// printed in progress, and hold off new ones. The initial file and the write-ahead
+// log must be loaded before it is shared, and it must be destroyed after every other
+// thread is done with it. No voter is handed out, as the slot of a deleted voter is
+// reused by the next insertion.
+
 // ------------------------------ DATABASE ------------------------------ //
 
-// Creates a DataBase
-DataBase database_create(int initial_size, int bucket_size, float load_threshold);
+// Creates a DataBase, whose table scrambles the pins with the hash family Hash_Kind
+DataBase database_create(int initial_size, int bucket_size, float load_threshold, HashKind Hash_Kind);
 
 // Opens the file with file_name, reads and saves line by line its contents (the voters)
-// into the DB
-void database_insert_file(const DataBase DB, char* file_name);
+// into the DB. If the file is a snapshot saved with database_save, the DB is loaded from
+// it instead, as it was when saved. N_Rows_Hint is the expected number of voters in the
+// file, used to presize the DB (if it is 0, the number is estimated from the size of the
+// file). With N_Threads > 1, the file is split at line boundaries and loaded by that many
+// threads at once
+void database_insert_file(const DataBase DB, char* file_name, size_t N_Rows_Hint, int N_Threads);
+
+// Opens (or creates) the write-ahead log with file_name, replays every change it holds on
+// the DB, and logs there every change made on the DB from then on. The changes are fsync'ed
+// as a group, every Group_Records changes or Group_Ms milliseconds after the first change
+// of the group, whichever comes first. A log that was logged on top of another file than
+// the one the DB was loaded from is refused, and the program exits
+void database_open_wal(const DataBase DB, const char* file_name, int Group_Records, int Group_Ms);
 
 // Opens the file with file_name, reads line by line its contents (the voters) and marks
-// as "voted" each of these voters (that also exist within the DB) in the DB.
-void database_voters_file_voted(const DataBase DB, const char* file_name);
+// as "voted" each of these voters (that also exist within the DB) in the DB. The outcome
+// is printed for every voter, or, if Quiet, only as a summary once the file is done
+void database_voters_file_voted(const DataBase DB, const char* file_name, bool Quiet);
 
-// Inserts a voter V into the DB
-void database_insert(const DataBase DB, Voter V);
+// Creates a voter with the given fields and inserts them into the DB. Returns false
+// (and inserts nothing) if a voter with pin = Pin is already in the DB
+bool database_insert(const DataBase DB, int Pin, const char* Name, const char* LastName, int Zipcode);
 
-// Searchs for a voter V within the DB
-Voter database_search(const DataBase DB, int Pin);
+// Deletes the voter with pin = Pin from the DB, along with their vote. Returns false
+// if there is no such voter
+bool database_delete(const DataBase DB, int Pin);
+
+// Prints the voter with pin = Pin. Returns false (and prints nothing) if there is
+// no such voter in the DB
+bool database_print_voter(const DataBase DB, int Pin);
 
 // Checks if a voter with pin = Pin exists in the DataBase
 bool database_exists(const DataBase DB, int Pin);
@@ -37,6 +64,10 @@ int database_n_voters_voted(const DataBase DB);
 // in a decreasing order
 void database_zipcodes_n_voters(const DataBase DB);
 
+// Prints the K zipcodes with the most voters, along with their number of voters,
+// in a decreasing order
+void database_top_zipcodes(const DataBase DB, int K);
+
 // Prints the number of voters who have voted, with zipcode = Zipcode
 void database_n_voters_voted_zipcode(const DataBase DB, int Zipcode);
 
@@ -44,5 +75,15 @@ void database_n_voters_voted_zipcode(const DataBase DB, int Zipcode);
 // with the total voters in the DataBase
 float database_perc(const DataBase DB);
 
+// Prints the statistics of the hashtable of the DB: its shape, the lengths of its
+// overflow chains, its splits and its memory. It is cheap enough to call at any time
+void database_print_stats(const DataBase DB);
+
+// Saves a snapshot of the whole DB into the file with file_name, which can later be
+// given to database_insert_file to restore the DB. The write-ahead log of the DB (if any)
+// is emptied, as its changes are all in the snapshot, which becomes its base: from then on,
+// it is only replayed on top of that snapshot. Returns false on failure
+bool database_save(const DataBase DB, const char* file_name);
+
 // Destroys the DataBase and frees allocated memory
 void database_destroy(const DataBase DB);
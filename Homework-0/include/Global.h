@@ -5,8 +5,12 @@
 // (the moment of the exit).  By normal exit we mean an exit triggered from the user.
 extern size_t bytes_freed;
 
-// For generic purpose, used in LinkedList
+// A generic pointer, the context handed back to callbacks (output sinks, WAL replay)
 typedef void* Pointer;
 
 // The basic item struct of the database, that we are storing within it
 typedef struct voter* Voter;
+
+// The arena in which all the voters (and their names) are allocated. A deleted
+// voter only frees its slot for the next voters, the whole store is freed at once
+typedef struct voter_store* VoterStore;
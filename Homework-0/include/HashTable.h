@@ -1,16 +1,78 @@
 #pragma once
 #include <stdbool.h>
+#include <stdio.h>
 #include "Global.h"
 
 typedef struct hash_table* HashTable;
 
+// The maximum number of pins hash_table_mark_voters_voted accepts at once
+#define HASH_TABLE_BATCH_SIZE 64
+
+// The number of bins of the chain length histogram of HashTableStats
+#define HASH_TABLE_STATS_CHAIN_BINS 8
+
+// The hash families the HashTable can scramble the pins with, before
+// addressing them with key % (2^i * m)
+typedef enum {
+    HASH_MODULO = 0,            // the pin itself
+    HASH_FIBONACCI,             // multiplicative (Fibonacci) hashing
+    HASH_MURMUR                 // the finalizer of MurmurHash3
+} HashKind;
+
+// The shape and history of a HashTable, as returned by hash_table_stats. Every
+// field is kept up to date as the table changes, so they cost nothing to read
+typedef struct hash_table_stats {
+    size_t n_buckets;                               // non-overflown buckets
+    size_t n_overflow_buckets;                      // overflown buckets, over every chain
+    size_t chains[HASH_TABLE_STATS_CHAIN_BINS];     // chains[i]: chains of i + 1 buckets (the last bin: of at least that many)
+    int    n_voters;
+    int    b_size;
+    int    round;
+    size_t p_index;
+    float  lambda;                                  // load factor
+    float  l_threshold;                             // load threshold
+    size_t n_splits;                                // splits since the table was created
+    size_t n_merges;                                // merges since the table was created
+    double split_ms;                                // time spent splitting since the table was created
+    size_t bytes;                                   // memory of the table (the voters themselves excluded)
+} HashTableStats;
+
 // ------------------------------ HASH TABLE ------------------------------ //
 
-// Creates a HashTable that makes use of linear hashing
-HashTable hash_table_create(int initial_size, int bucket_size, float load_threshold);
+// Finds the hash family with the given name ("modulo", "fibonacci" or "murmur").
+// Returns false if there is no such family
+bool hash_kind_from_name(const char* Name, HashKind* Hash_Kind);
+
+// Creates a HashTable that makes use of linear hashing, with the given hash family. The
+// buckets refer to the voters by their index within the store S, to halve their size
+HashTable hash_table_create(int initial_size, int bucket_size, float load_threshold, HashKind Hash_Kind, const VoterStore S);
+
+// Presizes an empty HashTable, so that inserting N voters into it needs no splits
+void hash_table_reserve(const HashTable HT, size_t N);
+
+// Inserts a voter into the HashTable, unless a voter with the same pin is already
+// there (then it returns false). Several threads may insert at once
+bool hash_table_insert(const HashTable HT, const Voter V);
+
+// Removes the voter with pin = Pin from the HashTable, and returns them (or NULL if
+// there is no such voter). Buckets are merged back once the load factor drops low
+// enough. Several threads may delete (and insert) at once
+Voter hash_table_delete(const HashTable HT, int Pin);
 
-// Inserts a voter into the HashTable
-void hash_table_insert(const HashTable HT, const Voter V);
+// Returns the number of buckets of the HashTable (without the overflown ones)
+size_t hash_table_n_buckets(const HashTable HT);
+
+// Returns the index of the bucket in which a voter with pin = Pin belongs
+size_t hash_table_bucket_index(const HashTable HT, int Pin);
+
+// Inserts a voter into their bucket, without splitting nor updating the number of voters
+// of the HashTable. Returns false (and inserts nothing) if the pin of V already exists.
+// Several threads may call it at once, as long as they never touch the same bucket.
+bool hash_table_bulk_insert(const HashTable HT, const Voter V);
+
+// Accounts for N voters inserted with hash_table_bulk_insert, and performs every split
+// those insertions would have triggered
+void hash_table_bulk_finish(const HashTable HT, size_t N);
 
 // Searches for a voter within the HashTable, by using their pin
 Voter hash_table_search(const HashTable HT, int Pin);
@@ -27,9 +89,32 @@ int hash_table_n_voters_voted(const HashTable HT);
 // If found in the HashTable, marks voter with pin = Pin as has_voted
 Voter hash_table_mark_voter_voted(const HashTable HT, int Pin);
 
+// Marks as voted the voters with pins Pins[0..N-1] (N <= HASH_TABLE_BATCH_SIZE), as a batch:
+// every bucket is prefetched before any of them is probed. Voters[i] is set to the voter with
+// pin Pins[i] (or NULL if there is no such voter), and Marked[i] to whether this call marked
+// them (false if they had already voted). Nothing is printed.
+void hash_table_mark_voters_voted(const HashTable HT, const int* Pins, int N, Voter* Voters, bool* Marked);
+
 // Returns the percentage of voters -within the HashTable- who have voted
 float hash_table_perc(const HashTable HT);
 
+// Fills Stats with the current shape and history of the HashTable. It is cheap (no
+// bucket is visited and no lock is taken), so it can be called at any time, even while
+// other threads change the table; the fields are then read one by one, not at once
+void hash_table_stats(const HashTable HT, HashTableStats* Stats);
+
+// Prints the statistics of the HashTable (see hash_table_stats)
+void hash_table_print_stats(const HashTable HT);
+
+// Writes the HashTable (as the table section of a snapshot) into File.
+// Returns false if a write failed
+bool hash_table_save(const HashTable HT, FILE* File);
+
+// Creates a HashTable out of the table section of a snapshot, of Size bytes starting at
+// Section, whose voters are found by index within the store S. Returns NULL if the
+// section is truncated or corrupt
+HashTable hash_table_load(const char* Section, size_t Size, const VoterStore S);
+
 // Destroys the HashTable and frees allocated memory
 void hash_table_destroy(HashTable HT);
 
@@ -7,12 +7,17 @@ typedef struct invterted_index* InvertedIndex;
 
 // ------------------------------ INVERTED INDEX ------------------------------ //
 
-// Creates an inverted index
-InvertedIndex inv_index_create(void);
+// Creates an inverted index. Its zipcodes refer to their voters by their index
+// within the store S, to halve the size of their lists
+InvertedIndex inv_index_create(const VoterStore S);
 
 // Inserts a voter into the inverted index
 void inv_index_insert(const InvertedIndex INV_INDEX, const Voter V);
 
+// Removes a voter (who has voted) from the inverted index. A zipcode left
+// without voters is removed as well
+void inv_index_remove(const InvertedIndex INV_INDEX, const Voter V);
+
 // Prints the number of voters who have voted, with zipcode = Zipcode
 void inv_index_n_voters_zipcode(const InvertedIndex INV_INDEX, int Zipcode);
 
@@ -20,5 +25,18 @@ void inv_index_n_voters_zipcode(const InvertedIndex INV_INDEX, int Zipcode);
 // in a decreasing order
 void inv_index_zipcodes_n_voters(const InvertedIndex INV_INDEX);
 
+// Prints the K zipcodes with the most voters along with their number of voters,
+// in a decreasing order (the first K lines that inv_index_zipcodes_n_voters prints)
+void inv_index_top_zipcodes(const InvertedIndex INV_INDEX, int K);
+
+// Writes the inverted index (as the index section of a snapshot) into File.
+// Returns false if a write failed
+bool inv_index_save(const InvertedIndex INV_INDEX, FILE* File);
+
+// Loads the index section of a snapshot, of Size bytes starting at Section, into the
+// empty INV_INDEX, whose voters are already in the store of INV_INDEX. Returns false
+// (loading nothing) if the section is truncated or corrupt
+bool inv_index_load(const InvertedIndex INV_INDEX, const char* Section, size_t Size);
+
 // Destroys the inverted index and frees allocated memory
 void inv_index_destroy(const InvertedIndex INV_INDEX);
@@ -0,0 +1,34 @@
+#pragma once
+#include <stddef.h>
+#include "Global.h"
+
+// ------------------------------ OUTPUT ------------------------------ //
+//
+// Everything the commands print goes through output_printf. By default it
+// goes to stdout; in server mode, the thread running a command sends its
+// output to the connection the command came from instead. Every thread
+// formats its output into a buffer of its own, which is handed over to the
+// sink in one piece (a single write, for stdout) once it's full or flushed.
+
+// Writes Size bytes of Data to the destination that Context stands for
+typedef void (*OutputSink)(const char* Data, size_t Size, Pointer Context);
+
+// Sends whatever the calling thread prints from now on to Sink (along with Context),
+// or back to stdout if Sink is NULL. What was printed before is flushed to the old sink
+void output_set_sink(OutputSink Sink, Pointer Context);
+
+// Formats the arguments as printf does, and prints them into the output of the calling thread
+void output_printf(const char* Format, ...) __attribute__((format(printf, 1, 2)));
+
+// Prints Size bytes of Data into the output of the calling thread
+void output_write(const char* Data, size_t Size);
+
+// Prints the integer Value into the output of the calling thread. Along with output_write,
+// it's a faster way than output_printf to print the lines of the commands with long outputs
+void output_int(int Value);
+
+// Hands whatever the calling thread has printed so far over to its sink
+void output_flush(void);
+
+// Flushes the output of the calling thread, and frees its buffer
+void output_close(void);
@@ -0,0 +1,22 @@
+#pragma once
+#include <stdbool.h>
+#include "Global.h"
+
+// ------------------------------ SERVER ------------------------------ //
+//
+// The server listens on a Unix domain socket, and serves all of its clients from a
+// single thread, with an epoll event loop. A client sends command lines (ended by a
+// new line character), and may send many of them without waiting for the responses
+// (pipelining): the commands of a client are executed in the order they were sent,
+// and their responses are sent back in that same order. The response of every command
+// is followed by an empty line, so that the client can tell the responses apart.
+
+// Handles a command Line of a client (without its new line character), printing its
+// response with output_printf. Returns false to close the connection of the client
+typedef bool (*ServerHandler)(char* Line, Pointer Context);
+
+// Listens on the Unix domain socket at socket_path, and hands every command line its
+// clients send to Handler (along with Context), until the process gets SIGINT or
+// SIGTERM. The socket file is removed at the end. Returns false (at once) if the
+// socket could not be set up
+bool server_run(const char* socket_path, ServerHandler Handler, Pointer Context);
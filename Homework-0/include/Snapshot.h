@@ -0,0 +1,100 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+// ------------------------------ SNAPSHOT FORMAT ------------------------------ //
+//
+// A snapshot is a binary image of a whole DataBase, that can be mapped and
+// loaded without any parsing or hashing. It holds no pointers at all: voters
+// are referred to by their index within the voter store, and names by their
+// id within the names pool (the n-th string of the strings section has id n). Every section starts at a multiple of
+// SNAPSHOT_ALIGNMENT, so the mapped file can be read in place. Layout:
+//
+//      snapshot_header
+//      voters section:  snapshot_store_header, snapshot_voter[n_voters],
+//                       strings[n_strings]           (the names pool, in order of id),
+//                       uint32_t free_slots[n_free]  (slots of deleted voters)
+//      table section:   snapshot_table_header, uint32_t bucket_counts[size],
+//                       uint32_t entries[n_voters]   (voter indices, chain by chain)
+//      index section:   snapshot_index_header, snapshot_zipcode[n_zipcodes],
+//                       uint32_t entries[n_entries]  (voter indices, zipcode by zipcode)
+//
+// The zipcodes are stored in the order the o command prints them. A snapshot
+// is never trusted: every section is checked to lie within the file, and every
+// count and index within it to be in range, before anything is loaded from it.
+
+#define SNAPSHOT_MAGIC       "MVOTESNP"
+#define SNAPSHOT_VERSION     4
+#define SNAPSHOT_BYTE_ORDER  0x01020304        // tells apart snapshots of the other endianness
+#define SNAPSHOT_ALIGNMENT   8
+
+typedef struct snapshot_header {
+    char     magic[8];
+    uint32_t byte_order;
+    uint32_t version;
+    uint64_t voters_offset;                    // offset of the voters section
+    uint64_t table_offset;                     // offset of the table section
+    uint64_t index_offset;                     // offset of the index section
+    uint64_t file_size;                        // total size of the snapshot
+    uint64_t id;                               // tells this snapshot apart from any other (never 0)
+    uint64_t log_base;                         // the base of the write-ahead log when saved (see Wal.h)
+} snapshot_header;
+
+typedef struct snapshot_store_header {
+    uint64_t n_voters;
+    uint64_t n_strings;                        // number of strings that follow the voters
+    uint64_t string_bytes;                     // size of those strings
+    uint64_t n_free;                           // number of slots of deleted voters
+    uint64_t free_offset;                      // offset of the free slots, within the section
+} snapshot_store_header;
+
+typedef struct snapshot_voter {
+    uint32_t name;                             // id of the name within the names pool
+    uint32_t surname;                          // id of the surname within the names pool
+    int32_t  pin;
+    int32_t  postal_code;
+    uint8_t  has_voted;
+    uint8_t  padding[7];
+} snapshot_voter;
+
+typedef struct snapshot_table_header {
+    uint64_t size;
+    uint64_t size_old;
+    uint64_t p_index;
+    uint64_t n_voters;
+    uint64_t n_voters_voted;
+    int32_t  init_size;
+    int32_t  b_size;
+    int32_t  round;
+    int32_t  hash_kind;
+    float    l_threshold;
+    uint32_t padding;
+} snapshot_table_header;
+
+typedef struct snapshot_index_header {
+    uint64_t n_zipcodes;
+    uint64_t n_entries;
+} snapshot_index_header;
+
+typedef struct snapshot_zipcode {
+    int32_t  postal_code;
+    uint32_t n_voters;
+} snapshot_zipcode;
+
+// Writes size bytes of data into file. Returns false if the write failed
+bool snapshot_write(FILE* file, const void* data, size_t size);
+
+// Pads file with zeros, up to the next multiple of SNAPSHOT_ALIGNMENT.
+// Returns false if the padding could not be written
+bool snapshot_align(FILE* file);
+
+// Checks if the size bytes starting at data hold a snapshot (only the header is checked,
+// along with the offsets of the sections, which must follow one another within the file)
+bool snapshot_is_valid(const char* data, size_t size);
+
+// Returns a new id for a snapshot, which is never 0
+uint64_t snapshot_new_id(void);
+
+// Checks if count items of item_size bytes, starting at offset, fit within size bytes
+bool snapshot_fits(size_t size, uint64_t offset, uint64_t count, size_t item_size);
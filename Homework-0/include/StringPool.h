@@ -0,0 +1,49 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+typedef struct string_pool* StringPool;
+
+// ------------------------------ STRING POOL ------------------------------ //
+//
+// The pool keeps a single copy of every distinct string interned into it, and
+// hands out a 32-bit id for it (the ids are 0, 1, 2, ... in order of interning).
+// Strings are never removed, so an id stays valid for as long as the pool does.
+
+// Creates an empty pool
+StringPool string_pool_create(void);
+
+// Returns the id of the Length first characters of String (which need not be null
+// terminated), interning them first if they are not in P yet. Several threads may
+// intern at once
+uint32_t string_pool_intern(const StringPool P, const char* String, size_t Length);
+
+// Interns the N strings of Strings (of the lengths in Lengths, which need not be null
+// terminated), as string_pool_intern would one by one, and stores their ids into Ids.
+// The lock of P is taken once for a whole batch of strings, instead of once per string:
+// shared to look all of them up, and then, if some were missing, exclusively to add them
+void string_pool_intern_batch(const StringPool P, const char* const* Strings, const size_t* Lengths,
+                              size_t N, uint32_t* Ids);
+
+// Returns the (null terminated) string with the given Id within P. It may be called
+// while other threads intern, for any Id handed out before
+const char* string_pool_get(const StringPool P, uint32_t Id);
+
+// Returns the number of strings within P
+size_t string_pool_size(const StringPool P);
+
+// Returns the total length of the strings within P, counting their terminating characters
+size_t string_pool_bytes(const StringPool P);
+
+// Writes the strings of P into File, in order of id, each one followed by its terminating
+// character (string_pool_bytes bytes in total). Returns false if a write failed
+bool string_pool_save(const StringPool P, FILE* File);
+
+// Interns the N consecutive null terminated strings starting at Strings (as written by
+// string_pool_save) into P, and stores the id each one got within P into Ids
+void string_pool_load(const StringPool P, const char* Strings, size_t N, uint32_t* Ids);
+
+// Destroys the pool and frees allocated memory
+void string_pool_destroy(StringPool P);
@@ -1,22 +1,98 @@
 #pragma once
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 #include "Global.h"
 
+// The index that stands for no voter at all (the store never hands it out)
+#define VOTER_NO_INDEX UINT32_MAX
+
+// The fields of a voter to be created, whose names need not be null terminated
+// (only the first name_len and surname_len characters of them are copied)
+typedef struct voter_fields {
+    int         pin;
+    const char* name;
+    size_t      name_len;
+    const char* surname;
+    size_t      surname_len;
+    int         postal_code;
+} VoterFields;
+
+// ------------------------------ VOTER STORE ------------------------------ //
+
+// Creates an empty voter store
+VoterStore voter_store_create(void);
+
+// Returns the number of voter slots allocated within the store S (deleted voters included)
+size_t voter_store_n_voters(const VoterStore S);
+
+// Reserves N consecutive voter slots in S, and returns the index of the first slot.
+// The slots are then filled with voter_create_batch_at, which may be called from several
+// threads at once for different slots
+size_t voter_store_reserve(const VoterStore S, size_t N);
+
+// Returns the voter with the given Index within S. It takes no lock, so it may be
+// called while other threads create voters, for any Index handed out before
+Voter voter_store_get(const VoterStore S, size_t Index);
+
+// Writes the voters of S (as the voters section of a snapshot) into File.
+// Returns false if a write failed
+bool voter_store_save(const VoterStore S, FILE* File);
+
+// Loads the voters section of a snapshot, of Size bytes starting at Section, into the
+// empty store S. Returns false (loading nothing) if the section is truncated or corrupt
+bool voter_store_load(const VoterStore S, const char* Section, size_t Size);
+
+// Destroys the store S, along with every voter allocated within it. The names of the
+// voters are interned into a pool shared by every store, which goes with the last one
+void voter_store_destroy(VoterStore S);
+
+
 // ------------------------------ VOTER ------------------------------ //
 
-// Creates a voter
-Voter voter_create(int Pin, const char* Name, const char* LastName, int PostalCode);
+// Creates a voter within the store S. Their names are interned, so voters with the same
+// name (or surname) share a single copy of it. Several threads may create voters at once
+Voter voter_create(const VoterStore S, int Pin, const char* Name, const char* LastName, int PostalCode);
+
+// Creates a voter within the store S, from names that are not null terminated
+// (only the first Name_Len and LastName_Len characters of them are copied)
+Voter voter_create_n(const VoterStore S, int Pin, const char* Name, size_t Name_Len,
+                     const char* LastName, size_t LastName_Len, int PostalCode);
+
+// Creates the N voters of Fields at the N consecutive slots of S starting at Index, which
+// were reserved with voter_store_reserve. Their names are interned as a batch, so that
+// threads creating voters at once seldom wait for each other on the pool of names
+void voter_create_batch_at(const VoterStore S, size_t Index, const VoterFields* Fields, size_t N);
+
+// Deletes the voter V of the store S. Its slot is reused by the next voters
+// created (their names stay in the pool)
+void voter_destroy(const VoterStore S, const Voter V);
 
 // Checks if voter V has voted
 bool voter_has_voted(const Voter V);
 
-// Marks a voter to have voted
-void voter_vote(const Voter V);
+// Marks a voter to have voted. Returns false if they had already voted
+bool voter_vote(const Voter V);
 
 // Gets the pin of the voter V
 int voter_get_pin(const Voter V);
 
-// Gets the pin of V
+// Gets the name of the voter V
+const char* voter_get_name(const Voter V);
+
+// Gets the surname of the voter V
+const char* voter_get_surname(const Voter V);
+
+// Gets the index of V within its store
+unsigned int voter_get_index(const Voter V);
+
+// Gets the position of V within the voters of its zipcode (in the InvertedIndex)
+unsigned int voter_get_zip_slot(const Voter V);
+
+// Sets the position of V within the voters of its zipcode
+void voter_set_zip_slot(const Voter V, unsigned int Slot);
+
+// Gets the zipcode of V
 int voter_get_zip(const Voter V);
 
 // Prints in a simple format the voter
@@ -24,6 +100,3 @@ void voter_print(const Pointer voter);
 
 // Prints only the pin from the voter
 void voter_print_pin(const Pointer voter);
-
-// Destroys voter and frees allocated memory
-void voter_destroy(const Pointer voter);
@@ -0,0 +1,97 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "Global.h"
+
+// ------------------------------ WAL FORMAT ------------------------------ //
+//
+// The write-ahead log is an append-only file of the mutations made on the
+// DataBase after its initial file was loaded, so that they can be replayed
+// on the next start. It starts with a header
+//
+//      char magic[8] (WAL_MAGIC), uint64_t base
+//
+// where base names the file the records were logged on top of: the id of a
+// snapshot, or WAL_BASE_VOTER_FILE for a voter file. Once a snapshot is saved,
+// the log is started over with that snapshot as its base, so that it is never
+// replayed on top of a file that lacks the changes made before the snapshot.
+// The header is followed by the records, each one being
+//
+//      uint32_t payload_size, uint32_t checksum (of the payload), payload
+//
+// where the payload is the type of the record followed by its fields:
+//
+//      WAL_INSERT:  int32_t pin, int32_t zipcode, uint16_t name_len,
+//                   uint16_t surname_len, uint8_t has_voted, name, surname
+//      WAL_MARK:    int32_t pin
+//      WAL_DELETE:  int32_t pin
+//
+// Records are gathered in memory and written (and fsync'ed) as one group,
+// either once enough of them are pending, or once the oldest of them has
+// waited long enough. A record that was cut short by a crash fails its
+// checksum, and is dropped (along with anything after it) on replay.
+
+#define WAL_MAGIC "MVOTEWAL"
+#define WAL_BASE_VOTER_FILE 0       // the base of a log started on a voter file
+
+typedef struct wal* Wal;
+
+typedef enum {
+    WAL_INSERT = 1,             // a voter was inserted
+    WAL_MARK,                   // a voter was marked as voted
+    WAL_DELETE                  // a voter was deleted
+} WalType;
+
+// A record of the log, as handed to the WalApply function on replay. The
+// name and surname point within the log, so they are not null terminated
+typedef struct wal_record {
+    WalType     type;
+    int         pin;
+    int         zipcode;
+    bool        has_voted;      // (insertions only) whether the voter had voted once logged
+    const char* name;
+    size_t      name_len;
+    const char* surname;
+    size_t      surname_len;
+} WalRecord;
+
+// Applies a record of the log to Context, on replay
+typedef void (*WalApply)(const WalRecord* Record, Pointer Context);
+
+// ------------------------------ WAL ------------------------------ //
+
+// Opens (or creates, with Base as its base) the log with file_name, for a DataBase that
+// was loaded from Base. A log whose base is neither Base nor Saved_Base (the base of the
+// log when the snapshot Base was saved, whose records the snapshot holds already) is
+// refused, and the program exits. Otherwise, every record already in it is first
+// handed, in order, to Apply along with Context. New records are then committed as
+// a group every Group_Records records, or Group_Ms milliseconds after the first
+// record of the group was logged, whichever comes first
+Wal wal_open(const char* file_name, uint64_t Base, uint64_t Saved_Base, int Group_Records, int Group_Ms,
+             WalApply Apply, Pointer Context);
+
+// Returns the base of the log (see WAL FORMAT)
+uint64_t wal_base(const Wal W);
+
+// Logs the insertion of the voter V. Whether V has voted is logged as well, and read
+// in order with every other record, so that a vote logged by another thread before
+// the insertion itself is not lost on replay
+void wal_log_insert(const Wal W, const Voter V);
+
+// Logs that the voter with pin = Pin was marked as voted
+void wal_log_mark(const Wal W, int Pin);
+
+// Logs that the voter with pin = Pin was deleted
+void wal_log_delete(const Wal W, int Pin);
+
+// Writes and fsyncs every record logged so far
+void wal_commit(const Wal W);
+
+// Commits and then empties the log, once its records are saved in the snapshot with
+// id = Base, which becomes the base of the log. The emptied log replaces the old one
+// at once, so a crash leaves either of them behind. Returns false on failure
+bool wal_truncate(const Wal W, uint64_t Base);
+
+// Commits every pending record, closes the log and frees allocated memory
+void wal_close(const Wal W);
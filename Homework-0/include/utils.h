@@ -1,10 +1,30 @@
 #pragma once
 #include <stdbool.h>
+#include <stddef.h>
+#include "HashTable.h"
+
+#define WAL_GROUP_RECORDS 64      // default records per group commit of the log (-c)
+#define WAL_GROUP_MS 10           // default milliseconds a record may wait for its group commit (-d)
+
+// The command-line arguments of the program
+typedef struct args {
+    char*  file_name;           // -f: the file to initialize the database with
+    int    bucket_size;         // -b: the size of the buckets in the hashtable
+    int    m;                   // -m: the initial size of the hashtable
+    size_t n_rows_hint;         // -n: expected number of voters in the file (0 if not given)
+    int    n_threads;           // -t: number of threads loading the file (1 if not given)
+    HashKind hash_kind;         // -h: hash family of the hashtable (modulo if not given)
+    char*  wal_file;            // -w: the write-ahead log of the database (NULL if not given)
+    int    group_records;       // -c: records per group commit of the log
+    int    group_ms;            // -d: milliseconds a record may wait for its group commit
+    char*  socket_path;         // -S: the Unix socket to serve the commands on (NULL to read them from stdin)
+    float  load_threshold;      // -l: load factor of the hashtable that triggers a split (0 if not given)
+} Args;
 
 // ------------------------------ UTILS ------------------------------ //
 
-// Initializes the -b, -m, -f flags and makes some initial filtering
-bool validArgs(int argc, char** argv, char** file_name, int* bucket_size, int* m, int max_args);
+// Initializes args from the -f, -b, -m (and optional) flags and makes some initial filtering
+bool validArgs(int argc, char** argv, Args* args, int min_args, int max_args);
 
 // Trims the \n character of a string
 void trimInput(char* input);
@@ -17,3 +37,12 @@ void clearInput(void);
 
 // Checks if a string is a positive integer number
 bool isPositiveIntegerNumber(const char* str);
+
+// Checks if a string is a positive integer number that fits in an int, and stores it in value if so
+bool isPositiveInt(const char* str, int* value);
+
+// Checks if a string is a positive integer number that fits in a size_t, and stores it in value if so
+bool isPositiveSize(const char* str, size_t* value);
+
+// Checks if a string is a positive real number, and stores it in value if so
+bool isPositiveRealNumber(const char* str, float* value);
@@ -3,10 +3,12 @@
 #include <string.h>
 #include <stdbool.h>
 #include <assert.h>
+#include <unistd.h>
 #include "../include/Command.h"
 #include "../include/DataBase.h"
-#include "../include/Voter.h"
 #include "../include/utils.h"
+#include "../include/Output.h"
+#include "../include/Server.h"
 
 #define INPUT_SIZE 768          // buffer size for input from the user
 
@@ -17,10 +19,14 @@ size_t bytes_freed = 0;
 static void cmd_l(const char*, const DataBase, int token_count);		// l command
 static void cmd_i(const char*, const DataBase, int token_count);		// i command
 static void cmd_m(const char*, const DataBase, int token_count);		// m command
-static void cmd_bv(const char*, const DataBase, int token_count);		// bv command
+static void cmd_d(const char*, const DataBase, int token_count);		// d command
+static void cmd_bv(const char*, const DataBase, int token_count);		// bv command (bv <file> [quiet])
 static void cmd_v(const DataBase, int token_count);						// v command
 static void cmd_perc(const DataBase, int token_count);					// perc commmand
 static void cmd_o(const DataBase, int token_count);						// o command
+static void cmd_stats(const DataBase, int token_count);					// stats command
+static void cmd_top(const char*, const DataBase, int token_count);		// top command
+static void cmd_save(const char*, const DataBase, int token_count);		// save command
 static void cmd_z(const char*, const DataBase, int token_count);		// z command
 static bool cmd_exit(const DataBase, int token_count);					// exit command
 
@@ -33,21 +39,55 @@ static bool cmd_exit(const DataBase, int token_count);					// exit command
 //        token_count:  The number of arguments of the given command
 static bool exec_cmd(const char* token, const DataBase DB, int token_count);
 
+// Executes a single command line (without the new line character), after tokenizing
+// it and making a first filtering. Returns false if the command was exit
+// Parameters:
+//        input:        The command line, which is tokenized in place
+//        DB:           The database of the program
+static bool run_cmd(char* input, const DataBase DB);
+
+// Executes a command line that a client of the server sent. Returns false
+// if the command was exit, which only closes the connection of the client
+static bool serve_cmd(char* input, Pointer context);
+
 // This function's sole purpose is to initialize the database with the file name given from the user
-// from the command line arguments
-static void init_file_db(const DataBase DB, char* file_name);
+// from the command line arguments. n_rows_hint is the expected number of voters in it (0 if unknown),
+// and n_threads the number of threads loading it
+static void init_file_db(const DataBase DB, char* file_name, size_t n_rows_hint, int n_threads);
 
 // ------------------------------ COMMAND ------------------------------ //
 
-void RunDB(char* file_path, int m, int bucket_size, float LOAD_THRESHOLD) {
+void RunDB(Args* args, float LOAD_THRESHOLD) {
 
-    if(file_path == NULL) {										// make a first check
-        printf("File could not be opened\n");					// for the file_path given
+    if(args->file_name == NULL) {								// make a first check
+        output_printf("File could not be opened\n");					// for the file_path given
         exit(EXIT_FAILURE);
     }
 
-    DataBase db = database_create(m, bucket_size, LOAD_THRESHOLD);		// database creation
-    init_file_db(db, file_path);								        // filling the database with initial file
+    DataBase db = database_create(args->m, args->bucket_size, LOAD_THRESHOLD, args->hash_kind);	// database creation
+    init_file_db(db, args->file_name, args->n_rows_hint, args->n_threads);				        // filling the database with initial file
+    args->file_name = NULL;
+
+    // Replaying the log of the changes made since the initial file, if any
+    if(args->wal_file != NULL) {
+        database_open_wal(db, args->wal_file, args->group_records, args->group_ms);
+        free(args->wal_file);
+        args->wal_file = NULL;
+    }
+
+    // Serving the commands of the clients of the socket, until the server is stopped
+    if(args->socket_path != NULL) {
+        bool served = server_run(args->socket_path, serve_cmd, db);
+        free(args->socket_path);
+        args->socket_path = NULL;
+
+        database_destroy(db);
+        if(!served)
+            exit(EXIT_FAILURE);
+        output_printf("%ld of Bytes Released\n", bytes_freed);
+        output_close();
+        return;
+    }
 
     // allocate memory for the input
 	char* input = malloc(sizeof(char) * (INPUT_SIZE + 1)); 	            // +1 for the string terminating character
@@ -56,14 +96,21 @@ void RunDB(char* file_path, int m, int bucket_size, float LOAD_THRESHOLD) {
         exit(EXIT_FAILURE);
     }
 
+    // The prompt has to be seen before the input is read only when a user is watching
+    // (as with stdio, whose stdout is line buffered only on a terminal). Otherwise the
+    // output of a batch of commands is written in as few pieces as possible
+    bool interactive = isatty(STDOUT_FILENO);
+
     while(1) {
-        printf("Give input: ");
+        output_printf("Give input: ");
+        if (interactive)
+            output_flush();
 
         if (fgets(input, INPUT_SIZE+1, stdin) != NULL) {
 
             // In case the user presses enter without writing anything else
             if(strcmp(input, "\n") == 0) {
-                printf("Malformed Input\n");
+                output_printf("Malformed Input\n");
                 continue;
             }
 
@@ -77,21 +124,7 @@ void RunDB(char* file_path, int m, int bucket_size, float LOAD_THRESHOLD) {
             // Trimming the new line character from the input
             trimInput(input);
 
-            int token_count = tokenCount(input);                // counting the number of words in input
-
-            // Tokenizing the command with whitespace delimeter. Token now will
-            // point to the first argument of the command given
-            char* token = strtok(input, " ");
-
-            // Make a first filter for the first argument and the total tokens count
-            if (token == NULL || *token == '\0' || token_count < 1) {
-                printf("Malformed Input\n");
-                continue;
-            }
-
-            // Finally, if the above filters have passed, call execute command
-            // function with the appropriate parameters
-            if(exec_cmd(token, db, token_count) == false)
+            if(run_cmd(input, db) == false)
                 break;
         }
         else
@@ -100,13 +133,45 @@ void RunDB(char* file_path, int m, int bucket_size, float LOAD_THRESHOLD) {
 
     free(input);
     bytes_freed += sizeof(char) * (INPUT_SIZE+1);
+    output_close();
+}
+
+bool run_cmd(char* input, const DataBase DB) {
+    int token_count = tokenCount(input);                // counting the number of words in input
+
+    // Tokenizing the command with whitespace delimeter. Token now will
+    // point to the first argument of the command given
+    char* token = strtok(input, " ");
+
+    // Make a first filter for the first argument and the total tokens count
+    if (token == NULL || *token == '\0' || token_count < 1) {
+        output_printf("Malformed Input\n");
+        return true;
+    }
+
+    // Finally, if the above filters have passed, call execute command
+    // function with the appropriate parameters
+    return exec_cmd(token, DB, token_count);
 }
 
+bool serve_cmd(char* input, Pointer context) {
+    DataBase DB = context;
 
-void init_file_db(const DataBase DB, char* file_path) {
+    if(*input == '\0') {
+        output_printf("Malformed Input\n");
+        return true;
+    }
+    if(strcmp(input, "exit") == 0)
+        return false;
+
+    return run_cmd(input, DB);
+}
+
+
+void init_file_db(const DataBase DB, char* file_path, size_t n_rows_hint, int n_threads) {
     assert(DB != NULL);
 
-    database_insert_file(DB, file_path);
+    database_insert_file(DB, file_path, n_rows_hint, n_threads);
 
     // We won't be needing file_path any longer, so free allocated space
     free(file_path);
@@ -127,6 +192,10 @@ bool exec_cmd(const char* token, const DataBase DB, int token_count) {
         cmd_m(token, DB, token_count);
         return true;
     }
+    if(strcmp(token, "d") == 0) {
+        cmd_d(token, DB, token_count);
+        return true;
+    }
     if(strcmp(token, "bv") == 0) {
         cmd_bv(token, DB, token_count);
         return true;
@@ -147,62 +216,69 @@ bool exec_cmd(const char* token, const DataBase DB, int token_count) {
         cmd_o(DB, token_count);
         return true;
     }
+    if(strcmp(token, "stats") == 0) {
+        cmd_stats(DB, token_count);
+        return true;
+    }
+    if(strcmp(token, "top") == 0) {
+        cmd_top(token, DB, token_count);
+        return true;
+    }
+    if(strcmp(token, "save") == 0) {
+        cmd_save(token, DB, token_count);
+        return true;
+    }
     if(strcmp(token, "exit") == 0) {
         if(cmd_exit(DB, token_count))
             return false;
         return true;
     }
 
-    printf("Malformed Input\n");
+    output_printf("Malformed Input\n");
     return true;
 }
 
 void cmd_l(const char* token, const DataBase DB, int token_count) {
     if(token_count != 2) {
-        printf("Malformed Input\n");
+        output_printf("Malformed Input\n");
         return;
     }
 
     // pin
     token = strtok(NULL, " ");
     if(!isPositiveIntegerNumber(token)) {
-        printf("Malformed Pin\n");
+        output_printf("Malformed Pin\n");
         return;
     }
     int pin = atoi(token);
 
-    Voter v = database_search(DB, pin);
-    if(v == NULL) {
-        printf("Participant %d not in cohort\n", pin);
-        return;
-    }
-
-    voter_print(v);
+    if(!database_print_voter(DB, pin))
+        output_printf("Participant %d not in cohort\n", pin);
 }
 
 void cmd_i(const char* token, const DataBase DB, int token_count) {
     if(token_count != 5) {
-        printf("Malformed Input\n");
+        output_printf("Malformed Input\n");
         return;
     }
 
     // pin
     token = strtok(NULL, " ");
     if(!isPositiveIntegerNumber(token)) {
-        printf("Malformed Input\n");
+        output_printf("Malformed Input\n");
         return;
     }
     int pin = atoi(token);
 
     if(database_exists(DB, pin)) {
-        printf("%d already exist\n", pin);
+        output_printf("%d already exist\n", pin);
         return;
     }
 
     // last name
     token = strtok(NULL, " ");
     if(token == NULL) {
-        printf("Malformed Input\n");
+        output_printf("Malformed Input\n");
         return;
     }
     const char* lname = token;
@@ -210,7 +286,7 @@ void cmd_i(const char* token, const DataBase DB, int token_count) {
     // first name
     token = strtok(NULL, " ");
     if(token == NULL) {
-        printf("Malformed Input\n");
+        output_printf("Malformed Input\n");
         return;
     }
     const char* fname = token;
@@ -218,31 +294,28 @@ void cmd_i(const char* token, const DataBase DB, int token_count) {
     // zipcode
     token = strtok(NULL, " ");
     if(!isPositiveIntegerNumber(token)) {
-        printf("Malformed Input\n");
+        output_printf("Malformed Input\n");
         return;
     }
     int zipcode = atoi(token);
 
-    if(database_exists(DB, pin)) {
-        printf("%d already exist\n", pin);
+    if(!database_insert(DB, pin, fname, lname, zipcode)) {
+        output_printf("%d already exist\n", pin);
         return;
     }
-
-    Voter v = voter_create(pin, fname, lname, zipcode);
-    database_insert(DB, v);
-    printf("Inserted %d %s %s %d N\n", pin, lname, fname, zipcode);
+    output_printf("Inserted %d %s %s %d N\n", pin, lname, fname, zipcode);
 }   
 
 void cmd_m(const char* token, const DataBase DB, int token_count) {
     if(token_count != 2) {
-        printf("Malformed Input\n");
+        output_printf("Malformed Input\n");
         return;
     }
 
     // pin
     token = strtok(NULL, " ");
     if(!isPositiveIntegerNumber(token)) {
-        printf("Malformed Input\n");
+        output_printf("Malformed Input\n");
         return;
     }
     int pin = atoi(token);
@@ -250,59 +323,117 @@ void cmd_m(const char* token, const DataBase DB, int token_count) {
     database_mark_voter_voted(DB, pin);
 }
 
-void cmd_bv(const char* token, const DataBase DB, int token_count) {
+void cmd_d(const char* token, const DataBase DB, int token_count) {
     if(token_count != 2) {
-        printf("Malformed Input\n");
+        output_printf("Malformed Input\n");
+        return;
+    }
+
+    // pin
+    token = strtok(NULL, " ");
+    if(!isPositiveIntegerNumber(token)) {
+        output_printf("Malformed Input\n");
+        return;
+    }
+    int pin = atoi(token);
+
+    if(database_delete(DB, pin))
+        output_printf("Deleted %d\n", pin);
+    else
+        output_printf("%d does not exist\n", pin);
+}
+
+void cmd_bv(const char* token, const DataBase DB, int token_count) {
+    if(token_count != 2 && token_count != 3) {
+        output_printf("Malformed Input\n");
         return;
     }
 
     // file
     token = strtok(NULL, " ");
     if(token == NULL) {
-        printf("%s could not be opened\n", token);
+        output_printf("Malformed Input\n");
         return;
     }
+    const char* file_name = token;
+
+    // quiet (optional): a summary is printed instead of a line per pin
+    bool quiet = false;
+    if(token_count == 3) {
+        token = strtok(NULL, " ");
+        if(token == NULL || strcmp(token, "quiet") != 0) {
+            output_printf("Malformed Input\n");
+            return;
+        }
+        quiet = true;
+    }
     
-    database_voters_file_voted(DB, token);
+    database_voters_file_voted(DB, file_name, quiet);
 }
 
 void cmd_v(const DataBase DB, int token_count) {
     if(token_count != 1) {
-        printf("Malformed Input\n");
+        output_printf("Malformed Input\n");
         return;
     }
     
-    printf("Voted So Far %d\n", database_n_voters_voted(DB));
+    output_printf("Voted So Far %d\n", database_n_voters_voted(DB));
 }
 
 void cmd_perc(const DataBase DB, int token_count) {
     if(token_count != 1) {
-        printf("Malformed Input\n");
+        output_printf("Malformed Input\n");
         return;
     }
 
-    printf("%.4f\n", database_perc(DB));
+    output_printf("%.4f\n", database_perc(DB));
 }
 
 void cmd_o(const DataBase DB, int token_count) {
     if(token_count != 1) {
-        printf("Malformed Input\n");
+        output_printf("Malformed Input\n");
         return;
     }
 
     database_zipcodes_n_voters(DB);
 }
 
+void cmd_stats(const DataBase DB, int token_count) {
+    if(token_count != 1) {
+        output_printf("Malformed Input\n");
+        return;
+    }
+
+    database_print_stats(DB);
+}
+
+void cmd_top(const char* token, const DataBase DB, int token_count) {
+    if(token_count != 2) {
+        output_printf("Malformed Input\n");
+        return;
+    }
+
+    // number of zipcodes (one that does not fit in an int is malformed too)
+    token = strtok(NULL, " ");
+    int k;
+    if(!isPositiveInt(token, &k)) {
+        output_printf("Malformed Input\n");
+        return;
+    }
+
+    database_top_zipcodes(DB, k);
+}
+
 void cmd_z(const char* token, const DataBase DB, int token_count) {
     if(token_count != 2) {
-        printf("Malformed Input\n");
+        output_printf("Malformed Input\n");
         return;
     }
 
     // zipcode
     token = strtok(NULL, " ");
     if(!isPositiveIntegerNumber(token)) {
-        printf("Malformed Zipcode\n");
+        output_printf("Malformed Zipcode\n");
         return;
     }
 
@@ -311,13 +442,33 @@ void cmd_z(const char* token, const DataBase DB, int token_count) {
     database_n_voters_voted_zipcode(DB, zipcode);
 }
 
+void cmd_save(const char* token, const DataBase DB, int token_count) {
+    if(token_count != 2) {
+        output_printf("Malformed Input\n");
+        return;
+    }
+
+    // file
+    token = strtok(NULL, " ");
+    if(token == NULL) {
+        output_printf("Malformed Input\n");
+        return;
+    }
+    if(!database_save(DB, token)) {
+        output_printf("%s could not be saved\n", token);
+        return;
+    }
+
+    output_printf("Saved %s\n", token);
+}
+
 bool cmd_exit(const DataBase DB, int token_count) {
     if(token_count != 1) {
-        printf("Malformed Input\n");
+        output_printf("Malformed Input\n");
         return false;
     }
 
     database_destroy(DB);
-    printf("%ld of Bytes Released\n", bytes_freed);
+    output_printf("%ld of Bytes Released\n", bytes_freed);
     return true;
 }
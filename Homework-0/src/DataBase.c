@@ -2,97 +2,586 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "../include/DataBase.h"
 #include "../include/HashTable.h"
 #include "../include/InvertedIndex.h"
 #include "../include/Voter.h"
+#include "../include/Snapshot.h"
+#include "../include/Wal.h"
+#include "../include/Output.h"
 
+#define ESTIMATE_SAMPLE_SIZE (64 * 1024)      // bytes sampled from the file to estimate its number of rows
+#define LOADER_BATCH_SIZE 256                 // voters a loader thread creates at once
 
-// ------------------------------ DATABASE ------------------------------ //
+
+// ------------------------------ STRUCTS ------------------------------ //
 typedef struct database {
     HashTable       ht;                   // The hashtable of the database
     InvertedIndex   inv_ind;              // The inverted index of the database 
+    VoterStore      store;                // The arena that owns every voter of the database
+    Wal             wal;                  // The log of the changes made on the database (NULL if none)
+    uint64_t        base;                 // The id of the snapshot the database was loaded from (see Wal.h)
+    uint64_t        saved_base;           // The base of the log when that snapshot was saved
+    pthread_rwlock_t changes_lock;        // Taken shared by every change (and voter printed), and exclusively by delete and save
 } database;
 
 
-DataBase database_create(int m, int bucket_size, float load_threshold) {
-    DataBase DB = malloc(sizeof(database));
-    DB->ht      = hash_table_create(m, bucket_size, load_threshold);
-    DB->inv_ind = inv_index_create();
-    return DB;
+// ------------------------------ FILE PARSING ------------------------------ //
+
+// A line of the initial file, as parsed straight out of its mapping. The name
+// and surname point within the mapping, so they are not null terminated
+typedef struct voter_record {
+    int         pin;
+    const char* surname;
+    size_t      surname_len;
+    const char* name;
+    size_t      name_len;
+    int         zipcode;
+} voter_record;
+
+// Moves cursor past any whitespace, up to end
+static const char* skip_spaces(const char* cursor, const char* end) {
+    while(cursor < end && isspace((unsigned char)*cursor))
+        cursor++;
+    return cursor;
 }
 
-void database_insert_file(const DataBase DB, char* file_path) {
-    assert(DB != NULL);
-    assert(file_path != NULL);
+// Parses an integer (with an optional sign) starting at *cursor, the same way
+// "%d" of scanf does, and moves *cursor right after it. Returns false if there
+// are no digits to parse
+static bool parse_int(const char** cursor, const char* end, int* value) {
+    const char* c = skip_spaces(*cursor, end);
 
-    int voter_pin;
-    char voter_name[256];
-    char voter_surname[256];
-    int voter_zipcode;
+    bool negative = false;
+    if(c < end && (*c == '-' || *c == '+')) {
+        negative = (*c == '-');
+        c++;
+    }
 
-    FILE* file = fopen(file_path, "r");
-    if(file == NULL) {
-        printf("%s could not be opened\n", file_path);
-        fclose(file);
+    const char* digits = c;
+    long result = 0;
+    while(c < end && *c >= '0' && *c <= '9') {
+        result = 10 * result + (*c - '0');
+        c++;
+    }
+    if(c == digits)
+        return false;
+
+    *value  = (int)(negative ? -result : result);
+    *cursor = c;
+    return true;
+}
+
+// Parses a word (a run of non whitespace characters) starting at *cursor, the
+// same way "%s" of scanf does, and moves *cursor right after it. The word is
+// not copied, *word simply points at it. Returns false if there is no word
+static bool parse_word(const char** cursor, const char* end, const char** word, size_t* len) {
+    const char* c = skip_spaces(*cursor, end);
+
+    const char* start = c;
+    while(c < end && !isspace((unsigned char)*c))
+        c++;
+    if(c == start)
+        return false;
+
+    *word   = start;
+    *len    = c - start;
+    *cursor = c;
+    return true;
+}
+
+// Parses the next "pin surname name zipcode" record starting at *cursor.
+// Returns false at the end of the input, or at the first malformed record
+static bool parse_voter_record(const char** cursor, const char* end, voter_record* record) {
+    return parse_int(cursor, end, &record->pin)
+        && parse_word(cursor, end, &record->surname, &record->surname_len)
+        && parse_word(cursor, end, &record->name, &record->name_len)
+        && parse_int(cursor, end, &record->zipcode);
+}
+
+// Estimates the number of rows of a file of file_size bytes starting at data,
+// from the average length of the lines within its first ESTIMATE_SAMPLE_SIZE bytes
+static size_t estimate_n_rows(const char* data, size_t file_size) {
+    size_t sample_size = (file_size < ESTIMATE_SAMPLE_SIZE) ? file_size : ESTIMATE_SAMPLE_SIZE;
+
+    size_t n_lines = 0;
+    for(size_t i = 0; i < sample_size; i++) {
+        if(data[i] == '\n')
+            n_lines++;
+    }
+
+    // A sample without a single full line can't tell us anything
+    if(n_lines == 0)
+        return 0;
+
+    return (size_t)((double)file_size * n_lines / sample_size);
+}
+
+
+// ------------------------------ PARALLEL LOADING ------------------------------ //
+
+// A growable array of voters
+typedef struct voter_vector {
+    Voter* voters;
+    size_t size;
+    size_t capacity;
+} voter_vector;
+
+// The state of a thread of the parallel loader. The file is split at line
+// boundaries into one chunk per thread, and the table into one partition
+// (a range of buckets) per thread. The loading happens in three phases:
+//      1) every thread counts the records of its chunk,
+//      2) every thread creates the voters of its chunk, in slots of the voter store
+//         reserved for it, and sorts them by partition,
+//      3) every thread inserts the voters of its own partition (taken from all the
+//         chunks, in file order), so no two threads ever touch the same bucket.
+typedef struct loader_thread* LoaderThread;
+
+typedef struct loader_thread {
+    DataBase      DB;
+    int           id;                // index of the thread (and of its chunk and partition)
+    int           n_threads;         // total number of threads
+    LoaderThread  threads;           // all the threads (needed in phase 3)
+    const char*   start;             // first byte of the chunk
+    const char*   end;               // one past the last byte of the chunk
+    size_t        n_records;         // number of records in the chunk
+    bool          malformed;         // whether a malformed record ended the chunk early
+    size_t        first_index;       // store index of the first voter of the chunk
+    voter_vector* partitions;        // voters of the chunk, per partition
+    bool          duplicate;         // whether a duplicate pin was found in the partition
+    int           duplicate_pin;     // that pin
+} loader_thread;
+
+// Appends the voter V at the end of vector
+static void voter_vector_append(voter_vector* vector, Voter V) {
+    if(vector->size == vector->capacity) {
+        vector->capacity = (vector->capacity == 0) ? 64 : 2 * vector->capacity;
+        vector->voters = realloc(vector->voters, sizeof(Voter) * vector->capacity);
+        if(vector->voters == NULL) {
+            fprintf(stderr, "Error: Memory reallocation failure | While reallocating memory for: voter_vector.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    vector->voters[vector->size++] = V;
+}
+
+// Phase 1: counts the records of the chunk
+static void* loader_count(void* arg) {
+    LoaderThread T = arg;
+
+    const char* cursor = T->start;
+    voter_record record;
+    while(parse_voter_record(&cursor, T->end, &record))
+        T->n_records++;
+
+    // If the parsing stopped before the end of the chunk, the
+    // loading stops there, just like the serial one does
+    T->malformed = (skip_spaces(cursor, T->end) != T->end);
+    return NULL;
+}
+
+// Phase 2: creates the voters of the chunk and sorts them by partition. The voters
+// are created in batches, so that the names of a whole batch are interned at once
+static void* loader_build(void* arg) {
+    LoaderThread T = arg;
+    HashTable H = T->DB->ht;
+    size_t n_buckets = hash_table_n_buckets(H);
+
+    const char* cursor = T->start;
+    voter_record record;
+    VoterFields batch[LOADER_BATCH_SIZE];
+    for(size_t first = 0; first < T->n_records; first += LOADER_BATCH_SIZE) {
+        size_t count = (T->n_records - first < LOADER_BATCH_SIZE) ? T->n_records - first : LOADER_BATCH_SIZE;
+        for(size_t i = 0; i < count; i++) {
+            parse_voter_record(&cursor, T->end, &record);
+            batch[i] = (VoterFields){ record.pin, record.name, record.name_len,
+                                      record.surname, record.surname_len, record.zipcode };
+        }
+        voter_create_batch_at(T->DB->store, T->first_index + first, batch, count);
+
+        for(size_t i = 0; i < count; i++) {
+            Voter v = voter_store_get(T->DB->store, T->first_index + first + i);
+            size_t partition = hash_table_bucket_index(H, batch[i].pin) * T->n_threads / n_buckets;
+            voter_vector_append(&T->partitions[partition], v);
+        }
+    }
+    return NULL;
+}
+
+// Phase 3: inserts the voters of the partition of the thread, chunk by chunk
+static void* loader_insert(void* arg) {
+    LoaderThread T = arg;
+
+    for(int chunk = 0; chunk < T->n_threads; chunk++) {
+        voter_vector* vector = &T->threads[chunk].partitions[T->id];
+        for(size_t i = 0; i < vector->size; i++) {
+            if(!hash_table_bulk_insert(T->DB->ht, vector->voters[i])) {
+                T->duplicate     = true;
+                T->duplicate_pin = voter_get_pin(vector->voters[i]);
+                return NULL;
+            }
+        }
+    }
+    return NULL;
+}
+
+// Runs routine on every thread of threads, and waits for all of them to finish
+static void loader_run_phase(LoaderThread threads, int n_threads, void* (*routine)(void*)) {
+    pthread_t* ids = malloc(sizeof(pthread_t) * n_threads);
+    if(ids == NULL) {
+        fprintf(stderr, "Error: Memory allocation failure | While allocating memory for: loader thread ids.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for(int i = 0; i < n_threads; i++) {
+        if(pthread_create(&ids[i], NULL, routine, &threads[i]) != 0) {
+            fprintf(stderr, "Error: Thread creation failure | While creating loader thread %d.\n", i);
+            exit(EXIT_FAILURE);
+        }
+    }
+    for(int i = 0; i < n_threads; i++)
+        pthread_join(ids[i], NULL);
+
+    free(ids);
+}
+
+// Loads the records of a mapped file of file_size bytes at data, with n_threads threads.
+// The file is expected to have one record per line, as records never cross chunks.
+static void database_insert_records_parallel(const DataBase DB, const char* data, size_t file_size,
+                                             int n_threads, const char* file_path) {
+    LoaderThread threads = calloc(n_threads, sizeof(loader_thread));
+    if(threads == NULL) {
+        fprintf(stderr, "Error: Memory allocation failure | While allocating memory for: loader threads.\n");
         exit(EXIT_FAILURE);
     }
 
-    while (fscanf(file, "%d %255s %255s %d", &voter_pin, voter_surname, voter_name, &voter_zipcode) == 4) {
+    // Split the file into chunks, at line boundaries
+    const char* end = data + file_size;
+    const char* start = data;
+    for(int i = 0; i < n_threads; i++) {
+        const char* chunk_end = data + file_size * (i + 1) / n_threads;
+        if(chunk_end < start)
+            chunk_end = start;
+        while(chunk_end < end && chunk_end[-1] != '\n')
+            chunk_end++;
+
+        threads[i].DB        = DB;
+        threads[i].id        = i;
+        threads[i].n_threads = n_threads;
+        threads[i].threads   = threads;
+        threads[i].start     = start;
+        threads[i].end       = chunk_end;
+        start = chunk_end;
+    }
+
+    loader_run_phase(threads, n_threads, loader_count);
 
-        // If voter_pin already exists in our DB, then we printout an error message,
-        // and simply exit the program with EXIT_FAILURE.
-        if(hash_table_exists(DB->ht, voter_pin)) {
-            fprintf(stderr, "Error: In initial file insertion. Pin: %d has duplicate appearances. File is %s.\n", voter_pin, file_path);
-            fclose(file);
+    // Everything after the first malformed record is ignored
+    size_t n_records = 0;
+    bool   malformed = false;
+    for(int i = 0; i < n_threads; i++) {
+        if(malformed) {
+            threads[i].n_records = 0;
+            continue;
+        }
+        n_records += threads[i].n_records;
+        malformed = threads[i].malformed;
+    }
+
+    // Now that the exact number of records is known, presize the table
+    // (the partitions depend on its final number of buckets)
+    if(is_hash_table_empty(DB->ht))
+        hash_table_reserve(DB->ht, n_records);
+
+    for(int i = 0; i < n_threads; i++) {
+        threads[i].partitions = calloc(n_threads, sizeof(voter_vector));
+        if(threads[i].partitions == NULL) {
+            fprintf(stderr, "Error: Memory allocation failure | While allocating memory for: loader partitions.\n");
             exit(EXIT_FAILURE);
         }
+        if(threads[i].n_records > 0)
+            threads[i].first_index = voter_store_reserve(DB->store, threads[i].n_records);
+    }
+
+    loader_run_phase(threads, n_threads, loader_build);
+    loader_run_phase(threads, n_threads, loader_insert);
 
-        Voter v = voter_create(voter_pin, voter_name, voter_surname, voter_zipcode);
+    // If a pin appears more than once, then we printout an error message,
+    // and simply exit the program with EXIT_FAILURE.
+    for(int i = 0; i < n_threads; i++) {
+        if(threads[i].duplicate) {
+            fprintf(stderr, "Error: In initial file insertion. Pin: %d has duplicate appearances. File is %s.\n", threads[i].duplicate_pin, file_path);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    hash_table_bulk_finish(DB->ht, n_records);
+
+    for(int i = 0; i < n_threads; i++) {
+        for(int j = 0; j < n_threads; j++)
+            free(threads[i].partitions[j].voters);
+        free(threads[i].partitions);
+    }
+    free(threads);
+}
+
+
+// ------------------------------ SNAPSHOTS ------------------------------ //
+
+// Loads the snapshot of file_size bytes mapped at data into the empty DB. The
+// table of the snapshot replaces the one of DB, since its shape (and
+// parameters) come from the snapshot as well
+static void database_load(const DataBase DB, const char* data, size_t file_size, const char* file_path) {
+    if(!snapshot_is_valid(data, file_size)) {
+        fprintf(stderr, "Error: In initial file insertion. File %s is not a valid snapshot (of this version).\n", file_path);
+        munmap((void*)data, file_size);
+        exit(EXIT_FAILURE);
+    }
+    assert(is_hash_table_empty(DB->ht));
+
+    const snapshot_header* header = (const snapshot_header*) data;
+    DB->base       = header->id;
+    DB->saved_base = header->log_base;
+
+    // Every section is bounded by the next one (and the last one by the end of the file)
+    bool loaded = voter_store_load(DB->store, data + header->voters_offset, header->table_offset - header->voters_offset);
+
+    HashTable H = loaded ? hash_table_load(data + header->table_offset, header->index_offset - header->table_offset, DB->store) : NULL;
+    if(H != NULL) {
+        hash_table_destroy(DB->ht);
+        DB->ht = H;
+    }
+
+    loaded = H != NULL && inv_index_load(DB->inv_ind, data + header->index_offset, file_size - header->index_offset);
+    if(!loaded) {
+        fprintf(stderr, "Error: In initial file insertion. File %s is a truncated or corrupt snapshot.\n", file_path);
+        munmap((void*)data, file_size);
+        exit(EXIT_FAILURE);
+    }
+}
+
+
+// ------------------------------ WAL REPLAY ------------------------------ //
+
+// Removes the voter with the given pin from the table and the index of DB, and
+// frees their slot. Returns false if there is no such voter
+static bool database_remove(const DataBase DB, int pin) {
+    Voter v = hash_table_delete(DB->ht, pin);
+    if(v == NULL)
+        return false;
+
+    if(voter_has_voted(v))
+        inv_index_remove(DB->inv_ind, v);
+    voter_destroy(DB->store, v);
+    return true;
+}
+
+// Applies a record of the log on the DB (passed as context). Replaying is silent,
+// and skips the changes that are already in the DB, so that a log can safely be
+// replayed on top of a snapshot that was saved after some of its records
+static void database_replay(const WalRecord* record, Pointer context) {
+    DataBase DB = context;
+
+    if(record->type == WAL_DELETE) {
+        database_remove(DB, record->pin);
+        return;
+    }
+
+    if(record->type == WAL_INSERT) {
+        if(hash_table_exists(DB->ht, record->pin))
+            return;
+        Voter v = voter_create_n(DB->store, record->pin, record->name, record->name_len,
+                                 record->surname, record->surname_len, record->zipcode);
         hash_table_insert(DB->ht, v);
+
+        // The voter may have been marked before their insertion was logged
+        if(!record->has_voted)
+            return;
     }
 
-    if (ferror(file)) {
+    Voter v;
+    bool marked;
+    hash_table_mark_voters_voted(DB->ht, &record->pin, 1, &v, &marked);
+    if(marked)
+        inv_index_insert(DB->inv_ind, v);
+}
+
+
+// ------------------------------ DATABASE ------------------------------ //
+DataBase database_create(int m, int bucket_size, float load_threshold, HashKind hash_kind) {
+    DataBase DB = malloc(sizeof(database));
+    DB->store      = voter_store_create();
+    DB->ht         = hash_table_create(m, bucket_size, load_threshold, hash_kind, DB->store);
+    DB->inv_ind    = inv_index_create(DB->store);
+    DB->wal        = NULL;
+    DB->base       = WAL_BASE_VOTER_FILE;
+    DB->saved_base = WAL_BASE_VOTER_FILE;
+    pthread_rwlock_init(&DB->changes_lock, NULL);
+    return DB;
+}
+
+void database_insert_file(const DataBase DB, char* file_path, size_t n_rows_hint, int n_threads) {
+    assert(DB != NULL);
+    assert(file_path != NULL);
+
+    int fd = open(file_path, O_RDONLY);
+    if(fd < 0) {
+        output_printf("%s could not be opened\n", file_path);
+        exit(EXIT_FAILURE);
+    }
+
+    struct stat file_stat;
+    if(fstat(fd, &file_stat) < 0) {
         fprintf(stderr, "Error: In initial file insertion. File is %s.\n", file_path);
         fprintf(stderr, "Error occurred while reading the file %s.\n", file_path);
-        fclose(file);
+        close(fd);
         exit(EXIT_FAILURE);
     }
 
+    // An empty file has nothing to insert (and can't be mapped either)
+    size_t file_size = file_stat.st_size;
+    if(file_size == 0) {
+        close(fd);
+        return;
+    }
+
+    // Map the whole file. Voters are parsed straight out of the mapping, and
+    // their names are interned from it directly into the names pool
+    const char* data = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED) {
+        fprintf(stderr, "Error: In initial file insertion. File is %s.\n", file_path);
+        fprintf(stderr, "Error occurred while mapping the file %s.\n", file_path);
+        exit(EXIT_FAILURE);
+    }
+    madvise((void*)data, file_size, MADV_SEQUENTIAL);
+
+    // The file may as well be a snapshot saved earlier, which is loaded as is
+    if(file_size >= sizeof(SNAPSHOT_MAGIC) - 1 && memcmp(data, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC) - 1) == 0) {
+        database_load(DB, data, file_size, file_path);
+        munmap((void*)data, file_size);
+        return;
+    }
+
+    if(n_threads > 1) {
+        database_insert_records_parallel(DB, data, file_size, n_threads, file_path);
+    }
+    else {
+        // Bulk load: build the table at its final size right away, from the hint
+        // of the user if given, or from an estimate based on the file size otherwise,
+        // instead of splitting buckets again and again while inserting the voters
+        if(is_hash_table_empty(DB->ht))
+            hash_table_reserve(DB->ht, (n_rows_hint > 0) ? n_rows_hint : estimate_n_rows(data, file_size));
+
+        const char* cursor = data;
+        const char* end    = data + file_size;
+        voter_record record;
+        while (parse_voter_record(&cursor, end, &record)) {
+
+            Voter v = voter_create_n(DB->store, record.pin, record.name, record.name_len,
+                                     record.surname, record.surname_len, record.zipcode);
+
+            // If voter_pin already exists in our DB, then we printout an error message,
+            // and simply exit the program with EXIT_FAILURE.
+            if(!hash_table_insert(DB->ht, v)) {
+                fprintf(stderr, "Error: In initial file insertion. Pin: %d has duplicate appearances. File is %s.\n", record.pin, file_path);
+                munmap((void*)data, file_size);
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+
     // The funtion below is only for testing purposes, simply uncomment it
     // and uncomment the function's body at the end of the file HashTable.c
     
     // hash_table_insert_test_print(DB->ht);
 
-    fclose(file);
+    munmap((void*)data, file_size);
+}
+
+// Marks as voted the n voters with the given pins, as one batch of the table,
+// and prints the outcome for each pin in order (unless quiet). The number of
+// pins found is added into *n_found
+static void database_mark_batch_voted(const DataBase DB, const int* pins, int n, bool quiet, size_t* n_found) {
+    Voter voters[HASH_TABLE_BATCH_SIZE];
+    bool  marked[HASH_TABLE_BATCH_SIZE];
+
+    pthread_rwlock_rdlock(&DB->changes_lock);
+    hash_table_mark_voters_voted(DB->ht, pins, n, voters, marked);
+    for(int i = 0; i < n; i++) {
+        if(marked[i]) {
+            inv_index_insert(DB->inv_ind, voters[i]);
+            if(DB->wal != NULL)
+                wal_log_mark(DB->wal, pins[i]);
+        }
+    }
+    pthread_rwlock_unlock(&DB->changes_lock);
+
+    for(int i = 0; i < n; i++)
+        *n_found += (voters[i] != NULL);
+    if(quiet)
+        return;
+
+    for(int i = 0; i < n; i++) {
+        output_int(pins[i]);
+        if(voters[i] == NULL)
+            output_write(" does not exist\n", sizeof(" does not exist\n") - 1);
+        else
+            output_write(" Marked Voted\n", sizeof(" Marked Voted\n") - 1);
+    }
 }
 
-void database_voters_file_voted(const DataBase DB, const char* file_name) {
+// Prints the summary of a quiet bv: how many of its n_pins pins were marked
+static void database_print_summary(size_t n_pins, size_t n_found) {
+    output_printf("%zu Marked Voted, %zu do not exist\n", n_found, n_pins - n_found);
+}
+
+void database_voters_file_voted(const DataBase DB, const char* file_name, bool quiet) {
     assert(DB != NULL);
     assert(file_name != NULL);
 
     FILE* file = fopen(file_name, "r");
     if(file == NULL) {
-        printf("%s could not be opened\n", file_name);
+        output_printf("%s could not be opened\n", file_name);
         return;
     }
 
+    // The pins are gathered into batches, so that the table can
+    // prefetch all of their buckets before probing any of them
+    int pins[HASH_TABLE_BATCH_SIZE];
+    int n_pins = 0;
+    size_t n_total = 0, n_found = 0;
+
     int voter_pin;
     char line[256];
     while (fgets(line, sizeof(line), file)) {
 
         if (sscanf(line, "%d", &voter_pin) != 1 || voter_pin < 0) {
-            printf("Malformed Input\n");
+            // The pins before the malformed one are still marked
+            database_mark_batch_voted(DB, pins, n_pins, quiet, &n_found);
+            if(quiet)
+                database_print_summary(n_total, n_found);
+            output_printf("Malformed Input\n");
             fclose(file);
             return;
         }
 
-        Voter v = hash_table_mark_voter_voted(DB->ht, voter_pin);
-        if(v != NULL) {
-            inv_index_insert(DB->inv_ind, v);
-            printf("%d Marked Voted\n", voter_pin);
+        pins[n_pins++] = voter_pin;
+        n_total++;
+        if(n_pins == HASH_TABLE_BATCH_SIZE) {
+            database_mark_batch_voted(DB, pins, n_pins, quiet, &n_found);
+            n_pins = 0;
         }
     }    
+    database_mark_batch_voted(DB, pins, n_pins, quiet, &n_found);
+    if(quiet)
+        database_print_summary(n_total, n_found);
 
     if (ferror(file)) {
         fprintf(stderr, "Error occurred while reading the file\n");
@@ -103,16 +592,68 @@ void database_voters_file_voted(const DataBase DB, const char* file_name) {
     fclose(file);
 }
 
-void database_insert(const DataBase DB, Voter V) {
-    assert(DB != NULL && V != NULL);
+bool database_insert(const DataBase DB, int pin, const char* name, const char* surname, int zipcode) {
+    assert(DB != NULL);
+
+    pthread_rwlock_rdlock(&DB->changes_lock);
+
+    // A pin already in the table is rejected before anything is created for it
+    if(hash_table_exists(DB->ht, pin)) {
+        pthread_rwlock_unlock(&DB->changes_lock);
+        return false;
+    }
+
+    // The voter is logged once in the table, along with their vote, in case another
+    // thread has already marked them (and logged that before this insertion). Another
+    // thread may still insert the same pin in between: the voter is then released
+    Voter v = voter_create(DB->store, pin, name, surname, zipcode);
+    bool inserted = hash_table_insert(DB->ht, v);
+    if(inserted && DB->wal != NULL)
+        wal_log_insert(DB->wal, v);
+    if(!inserted)
+        voter_destroy(DB->store, v);
+
+    pthread_rwlock_unlock(&DB->changes_lock);
+
+    return inserted;
+}
+
+bool database_delete(const DataBase DB, int pin) {
+    assert(DB != NULL);
+
+    // A deletion holds off every other change: a voter being marked (or
+    // inserted again) meanwhile could otherwise reach the index, or the
+    // log, out of order with their deletion
+    pthread_rwlock_wrlock(&DB->changes_lock);
 
-    hash_table_insert(DB->ht, V);
+    bool deleted = database_remove(DB, pin);
+    if(deleted && DB->wal != NULL)
+        wal_log_delete(DB->wal, pin);
+
+    pthread_rwlock_unlock(&DB->changes_lock);
+
+    return deleted;
 }
 
-Voter database_search(const DataBase DB, int pin) {
+void database_open_wal(const DataBase DB, const char* file_path, int group_records, int group_ms) {
     assert(DB != NULL);
+    assert(DB->wal == NULL);
 
-    return hash_table_search(DB->ht, pin);
+    DB->wal = wal_open(file_path, DB->base, DB->saved_base, group_records, group_ms, database_replay, DB);
+}
+
+bool database_print_voter(const DataBase DB, int pin) {
+    assert(DB != NULL);
+
+    // The voter is looked up and printed with the changes lock held (shared), so
+    // that they are not deleted meanwhile, and their slot reused by another voter
+    pthread_rwlock_rdlock(&DB->changes_lock);
+    Voter v = hash_table_search(DB->ht, pin);
+    if(v != NULL)
+        voter_print(v);
+    pthread_rwlock_unlock(&DB->changes_lock);
+
+    return (v != NULL);
 }
 
 bool database_exists(const DataBase DB, int pin) {
@@ -139,11 +680,18 @@ void database_zipcodes_n_voters(const DataBase DB) {
     inv_index_zipcodes_n_voters(DB->inv_ind);
 }
 
+void database_top_zipcodes(const DataBase DB, int k) {
+    assert(DB != NULL);
+
+    inv_index_top_zipcodes(DB->inv_ind, k);
+}
+
 void database_mark_voter_voted(const DataBase DB, int pin) {
     assert(DB != NULL);
 
     // Firstly, update the entry with the pin, inside the 
     // hash table
+    pthread_rwlock_rdlock(&DB->changes_lock);
     Voter v = hash_table_mark_voter_voted(DB->ht, pin);
 
     // If v is NULL that means that the voter v either doesn't
@@ -151,8 +699,76 @@ void database_mark_voter_voted(const DataBase DB, int pin) {
     // insertion in our inverted index struct, only if v != NULL
     if(v != NULL) {
         inv_index_insert(DB->inv_ind, v);
-        printf("%d Marked Voted\n", pin);
+        if(DB->wal != NULL)
+            wal_log_mark(DB->wal, pin);
+    }
+    pthread_rwlock_unlock(&DB->changes_lock);
+
+    if(v != NULL)
+        output_printf("%d Marked Voted\n", pin);
+}
+
+bool database_save(const DataBase DB, const char* file_path) {
+    assert(DB != NULL);
+    assert(file_path != NULL);
+
+    // The snapshot is written next to file_path, and only replaces
+    // it once complete, so that a crash never leaves half a snapshot
+    size_t len = strlen(file_path);
+    char* temp_path = malloc(len + sizeof(".tmp"));
+    if(temp_path == NULL) {
+        fprintf(stderr, "Error: Memory allocation failure | While allocating memory for: temp_path.\n");
+        exit(EXIT_FAILURE);
     }
+    memcpy(temp_path, file_path, len);
+    memcpy(temp_path + len, ".tmp", sizeof(".tmp"));
+
+    FILE* file = fopen(temp_path, "wb");
+    if(file == NULL) {
+        free(temp_path);
+        return false;
+    }
+
+    // No change may happen while saving, so that the snapshot is consistent,
+    // and no change may be logged until the log is emptied
+    pthread_rwlock_wrlock(&DB->changes_lock);
+
+    // The header is written last, once the offsets are known. The first
+    // write that fails (a full disk, say) gives up on the whole snapshot
+    snapshot_header header = { 0 };
+    bool saved = snapshot_write(file, &header, sizeof(header)) && snapshot_align(file);
+
+    header.voters_offset = ftell(file);
+    saved = saved && voter_store_save(DB->store, file);
+    header.table_offset = ftell(file);
+    saved = saved && hash_table_save(DB->ht, file);
+    header.index_offset = ftell(file);
+    saved = saved && inv_index_save(DB->inv_ind, file);
+    header.file_size = ftell(file);
+    header.id        = snapshot_new_id();
+    header.log_base  = (DB->wal != NULL) ? wal_base(DB->wal) : header.id;
+
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.byte_order = SNAPSHOT_BYTE_ORDER;
+    header.version    = SNAPSHOT_VERSION;
+    rewind(file);
+    saved = saved && snapshot_write(file, &header, sizeof(header));
+
+    saved = saved && fflush(file) == 0 && fsync(fileno(file)) == 0;
+    saved = (fclose(file) == 0) && saved;
+    saved = saved && (rename(temp_path, file_path) == 0);
+    if(!saved)
+        remove(temp_path);
+
+    // The changes logged so far are all in the snapshot now, so the log starts over
+    // on top of it. Should that fail, the snapshot still accepts the old log
+    if(saved && DB->wal != NULL)
+        saved = wal_truncate(DB->wal, header.id);
+
+    pthread_rwlock_unlock(&DB->changes_lock);
+
+    free(temp_path);
+    return saved;
 }
 
 float database_perc(const DataBase DB) {
@@ -161,12 +777,26 @@ float database_perc(const DataBase DB) {
     return hash_table_perc(DB->ht);
 }
 
+void database_print_stats(const DataBase DB) {
+    assert(DB != NULL);
+
+    hash_table_print_stats(DB->ht);
+}
+
 void database_destroy(const DataBase DB) {
     if(DB == NULL)
         return;
 
+    // Commit whatever is still pending in the log, before anything is freed
+    wal_close(DB->wal);
+
     inv_index_destroy(DB->inv_ind);
     hash_table_destroy(DB->ht);
+
+    // Every voter lives in the store, so they are all freed at once here
+    voter_store_destroy(DB->store);
+
+    pthread_rwlock_destroy(&DB->changes_lock);
     
     free(DB);
     bytes_freed += sizeof(database);
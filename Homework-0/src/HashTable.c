@@ -1,83 +1,208 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 #include "../include/HashTable.h"
-#include "../include/LinkedList.h"
 #include "../include/Voter.h"
+#include "../include/Snapshot.h"
+#include "../include/Output.h"
 
-// State of the bucket
-typedef enum { empty = 0, full } b_state;
-
+#define HASH_TABLE_N_STRIPES 128        // number of locks the chains of the buckets are striped over
+#define HASH_TABLE_SEGMENT_BITS 6       // the first segment of the directory holds 2^6 buckets
+#define HASH_TABLE_N_SEGMENTS (64 - HASH_TABLE_SEGMENT_BITS + 1)      // enough segments for any index
+#define HASH_TABLE_MERGE_FACTOR 0.25    // buckets are merged once the load factor drops below l_threshold * 0.25
 
 // ------------------------------ STRUCTS ------------------------------ //
 typedef struct bucket* Bucket;
 
+// The bucket keeps the pins of its voters in a contiguous array, next to the
+// array of their indices within the voter store (structure of arrays). This way
+// a lookup only scans pins_array, and fetches just the voter that matches. Both
+// arrays are allocated in the same block as the bucket itself.
 typedef struct bucket {
-    Voter*  voters_array;              // voters array
+    int*      pins_array;              // pins of the voters, slot by slot
+    uint32_t* voters_array;            // indices of the voters within the store
     int     b_size;                    // bucket size 
-    b_state state;                     // state of the bucket (empty/full)
+    int     n_voters;                  // number of occupied slots (the first n_voters ones)
     Bucket  next;                      // next bucket (overflown)
 } bucket;
 
 
+// The buckets live in a segmented directory instead of one array: segment 0 holds the
+// first 2^HASH_TABLE_SEGMENT_BITS buckets, and every segment k > 0 as many buckets as all
+// the segments before it together. A segment is allocated once the table grows into
+// it, and is never moved, so a split only ever writes the slot of its new bucket.
 typedef struct hash_table {
-    Bucket* buckets_array;          // array of buckets (1-d vertical)
+    Bucket* segments[HASH_TABLE_N_SEGMENTS];    // the directory of buckets (see hash_table_slot)
+    VoterStore store;               // the store the voters of the buckets are found in
     size_t  init_size;              // initial size (variable m from the paper)
     size_t  size;                   // the current size (the number of non-overflown buckets)
     size_t  size_old;               // the size (the number of non-overflown buckets) from the previous round
     int     n_voters_voted;         // total number of voters who have voted
     int     b_size;                 // bucket size
     int     n_voters;               // number of voters
-    float   lambda;                 // load factor  (variable lambda from the paper)
     size_t  p_index;                // index p (variable p from the paper)
+    HashKind hash_kind;             // the hash family scrambling the pins
     int     round;                  // round
     float   l_threshold;            // load threshold
+
+    // Lookups and inserts only take the stripe lock of the bucket they probe, shared
+    // to read its chain or exclusively to change it (see hash_table_lock_bucket).
+    // A split takes split_lock, and the stripe locks of the two buckets it touches,
+    // and then publishes the new shape of the table (round and p_index) at once
+    uint64_t shape;                                         // round << 32 | p_index
+    pthread_mutex_t  split_lock;
+    pthread_rwlock_t stripe_locks[HASH_TABLE_N_STRIPES];    // bucket i is guarded by stripe i % HASH_TABLE_N_STRIPES
+
+    // Statistics (see hash_table_stats), updated atomically along with the table,
+    // as inserts and deletes of other buckets may update them at the same time
+    size_t   n_chain_buckets;                           // buckets of every chain, overflown ones included
+    size_t   chains[HASH_TABLE_STATS_CHAIN_BINS];       // chains[i]: chains of i + 1 buckets (or more, for the last one)
+    size_t   segment_bytes;                             // bytes of the segments allocated
+    size_t   n_splits;
+    size_t   n_merges;
+    uint64_t split_ns;                                  // nanoseconds spent splitting
 } hash_table;
 
 
 // ------------------------- HASH TABLE UTILS ------------------------- //
 
 // A simple function that returns the number 2^i
-static int power_of_two(int i) {
+static size_t power_of_two(int i) {
     if(i < 0)
         return 0;
-    return 1 << i;
+    return (size_t)1 << i;
 }
 
 // As with the paper of this exercise, the hash function we are going
-// to be using is the following
-static int hash_function(int key, int i, int m) {
+// to be using is the following. The key is not the pin itself though,
+// it is the pin scrambled by the hash family of the table (see hash_key)
+static size_t hash_function(unsigned int key, int i, size_t m) {
     return key % (power_of_two(i) * m);
 }
 
-// Given the Hashtable, this function calculates the load factor
+// Scrambles pin with the hash family of H. Linear hashing only needs
+// h_i(key) = key % (2^i * m) for some fixed key of each voter, so any
+// function of the pin can be used here without breaking the split rule:
+//      modulo:    the pin itself, as in the paper
+//      fibonacci: the high half of pin * 2^64/phi (multiplicative hashing)
+//      murmur:    the 32-bit finalizer of MurmurHash3
+// The last two spread pins issued in blocks (or sharing low bits)
+// evenly among the buckets.
+static unsigned int hash_key(const HashTable H, int pin) {
+    uint32_t key = (uint32_t)pin;
+
+    switch(H->hash_kind) {
+        case HASH_FIBONACCI:
+            return (uint32_t)(((uint64_t)key * 11400714819323198485ull) >> 32);
+
+        case HASH_MURMUR:
+            key ^= key >> 16;
+            key *= 0x85ebca6b;
+            key ^= key >> 13;
+            key *= 0xc2b2ae35;
+            key ^= key >> 16;
+            return key;
+
+        case HASH_MODULO:
+        default:
+            return key;
+    }
+}
+
+// Returns the current shape of the table, as last published by a split
+static uint64_t hash_table_shape(const HashTable H) {
+    return __atomic_load_n(&H->shape, __ATOMIC_ACQUIRE);
+}
+
+// Publishes round and p_index of H, once every bucket they address is in place
+static void hash_table_publish_shape(const HashTable H) {
+    assert(H->p_index <= UINT32_MAX);
+
+    __atomic_store_n(&H->shape, ((uint64_t)H->round << 32) | H->p_index, __ATOMIC_RELEASE);
+}
+
+// Returns the number of non-overflown buckets of a table with the given shape
+static size_t shape_size(const HashTable H, uint64_t shape) {
+    return (H->init_size << (shape >> 32)) + (uint32_t)shape;
+}
+
+// Given the Hashtable, this function calculates the load factor (variable lambda
+// from the paper). It is not stored, as several inserts may update n_voters at once
 static float calc_lambda(HashTable H) {
-    return ((float)H->n_voters) / ((float)(H->size * H->b_size));
+    return ((float)__atomic_load_n(&H->n_voters, __ATOMIC_RELAXED)) / ((float)(shape_size(H, hash_table_shape(H)) * H->b_size));
+}
+
+// Returns the lock guarding the chain of the bucket at index
+static pthread_rwlock_t* hash_table_stripe(const HashTable H, size_t index) {
+    return &H->stripe_locks[index % HASH_TABLE_N_STRIPES];
+}
+
+static void hash_table_locks_init(const HashTable H) {
+    pthread_mutex_init(&H->split_lock, NULL);
+    for(int i = 0; i < HASH_TABLE_N_STRIPES; i++)
+        pthread_rwlock_init(&H->stripe_locks[i], NULL);
+}
+
+// Accounts for a chain of old_length buckets now having new_length buckets. A chain
+// that is created has old_length = 0, and a chain that is taken out new_length = 0
+static void hash_table_count_chain(const HashTable H, size_t old_length, size_t new_length) {
+    if(old_length == new_length)
+        return;
+
+    if(old_length > 0) {
+        size_t bin = (old_length < HASH_TABLE_STATS_CHAIN_BINS) ? old_length - 1 : HASH_TABLE_STATS_CHAIN_BINS - 1;
+        __atomic_fetch_sub(&H->chains[bin], 1, __ATOMIC_RELAXED);
+        __atomic_fetch_sub(&H->n_chain_buckets, old_length, __ATOMIC_RELAXED);
+    }
+    if(new_length > 0) {
+        size_t bin = (new_length < HASH_TABLE_STATS_CHAIN_BINS) ? new_length - 1 : HASH_TABLE_STATS_CHAIN_BINS - 1;
+        __atomic_fetch_add(&H->chains[bin], 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&H->n_chain_buckets, new_length, __ATOMIC_RELAXED);
+    }
+}
+
+// Returns the current time in nanoseconds, from a clock that never goes back
+static uint64_t now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+static void hash_table_locks_destroy(const HashTable H) {
+    pthread_mutex_destroy(&H->split_lock);
+    for(int i = 0; i < HASH_TABLE_N_STRIPES; i++)
+        pthread_rwlock_destroy(&H->stripe_locks[i]);
 }
 
 
 // ------------------------------ BUCKET ------------------------------ //
 
+// Returns the number of bytes a bucket of size bucket_size occupies
+static size_t bucket_bytes(int bucket_size) {
+    return sizeof(bucket) + (sizeof(uint32_t) + sizeof(int)) * bucket_size;
+}
+
 // A constructor for the bucket, given the bucket size
 static Bucket bucket_create(int bucket_size) {
-    Bucket B = malloc(sizeof(bucket));
+    Bucket B = malloc(bucket_bytes(bucket_size));
     if(B == NULL) {
         fprintf(stderr, "Error: Memory allocation failure | While allocating memory for: bucket.\n");
         exit(EXIT_FAILURE);
     }
 
-    B->b_size = bucket_size;
-    B->voters_array = malloc(sizeof(Voter)*bucket_size);
-    if(B->voters_array == NULL) {
-        fprintf(stderr, "Error: Memory allocation failure | While allocating memory for: bucket.\n");
-        exit(EXIT_FAILURE);
-    }
-
-    for(int i = 0; i < bucket_size; i++) {
-        B->voters_array[i] = NULL;
-    }
-    B->state = empty;           // initially the bucket's state is empty
-    B->next = NULL;             // and there are no overflown buckets
+    // The arrays are placed right after the bucket, voters first
+    B->voters_array = (uint32_t*)(B + 1);
+    B->pins_array   = (int*)(B->voters_array + bucket_size);
+    B->b_size       = bucket_size;
+    B->n_voters     = 0;           // initially the bucket is empty
+    B->next         = NULL;        // and there are no overflown buckets
 
     return B;
 }
@@ -90,77 +215,98 @@ static void bucket_destroy(Bucket B, bool count_bytes) {
     if(B == NULL)
         return;
 
-    if(!count_bytes) {
-        free(B->voters_array);
-        free(B);
-        B = NULL;
-        return;
-    }
-
-    for(int i = 0; i < B->b_size; i++) {
-        if(B->voters_array[i] == NULL)
-            break;
-        // Only by this point, we are freeing the voters
-        voter_destroy(B->voters_array[i]);
-    }
-    free(B->voters_array);
-    bytes_freed += sizeof(Voter)* B->b_size;
+    // The voters themselves are owned by the voter store
+    // of the database, so only the bucket is freed here
+    if(count_bytes)
+        bytes_freed += bucket_bytes(B->b_size);
 
     free(B);
-    B = NULL;
-    bytes_freed += sizeof(bucket);
 }
 
-// Inserts a voter within the bucket B
-static void bucket_insert(const Bucket B, Voter V) {
+// Checks if all the slots of the bucket B are occupied
+static bool bucket_is_full(const Bucket B) {
     assert(B != NULL);
-    assert(V != NULL);
 
-    int counter = 0;
-    for(int i=0; i < B->b_size; i++) {
-        if(B->voters_array[i] == NULL) {
-            B->voters_array[i] = V;
-            counter++;
-            break;
-        }
-        counter++;
-    }
+    return (B->n_voters == B->b_size);
+}
+
+// Inserts the voter with the given pin and index (within the store)
+// into the bucket B, which must not be full
+static void bucket_insert(const Bucket B, int pin, uint32_t index) {
+    assert(B != NULL);
+    assert(!bucket_is_full(B));
 
-    // If we reached the end of the bucket's size,
-    // update the state of the bucket to full
-    if(counter == B->b_size)
-        B->state = full;
+    B->pins_array[B->n_voters]   = pin;
+    B->voters_array[B->n_voters] = index;
+    B->n_voters++;
 }
 
-// Searches for a voter with voter_pin = pin. If they
-// are not found, returns NULL
-static Voter bucket_search(const Bucket B, int pin) {
-    for(int i=0; i < B->b_size; i++) {
-        if(B->voters_array[i] == NULL)                  // Reached the end
-            break;
-        if(voter_get_pin(B->voters_array[i]) == pin)
-            return B->voters_array[i];
+// Returns the index of pin within the first n slots of pins, or -1 if it is
+// not there. Keys are compared 16 at a time with AVX2 or 8 at a time with
+// SSE2 (whichever the compiler targets), and the rest one by one.
+static int pins_find(const int* pins, int n, int pin) {
+    int i = 0;
+
+#if defined(__AVX2__)
+    const __m256i key = _mm256_set1_epi32(pin);
+    for(; i + 16 <= n; i += 16) {
+        __m256i low  = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(pins + i)), key);
+        __m256i high = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(pins + i + 8)), key);
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(low))
+                 | (_mm256_movemask_ps(_mm256_castsi256_ps(high)) << 8);
+        if(mask != 0)
+            return i + __builtin_ctz(mask);
     }
+#elif defined(__SSE2__)
+    const __m128i key = _mm_set1_epi32(pin);
+    for(; i + 8 <= n; i += 8) {
+        __m128i low  = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(pins + i)), key);
+        __m128i high = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(pins + i + 4)), key);
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(low))
+                 | (_mm_movemask_ps(_mm_castsi128_ps(high)) << 4);
+        if(mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+#endif
 
-    // If such voter isn't found
-    return NULL;   
+    // Scalar fallback, for the remaining keys (or all of them
+    // on targets without SSE2)
+    for(; i < n; i++) {
+        if(pins[i] == pin)
+            return i;
+    }
+    return -1;
 }
 
-// Returns the voter stored at B->voters_array[index]
-static Voter bucket_remove_voter(const Bucket B, int index) {
-    assert(B != NULL);
-    assert(B->b_size > index);
+// Searches for a voter with voter_pin = pin, and returns their index
+// within the store. If they are not found, returns VOTER_NO_INDEX
+static uint32_t bucket_search(const Bucket B, int pin) {
+    int index = pins_find(B->pins_array, B->n_voters, pin);
 
+    // If such voter isn't found
+    if(index < 0)
+        return VOTER_NO_INDEX;
     return B->voters_array[index];
 }
 
-// Empties the bucket_to_empty and sets it's state to empty
-static void bucket_empty(Bucket bucket_to_empty) {
-    for(int i=0; i < bucket_to_empty->b_size; i++)
-        bucket_to_empty->voters_array[i] = NULL;
+// Removes the entry at slot i of B, moving its last entry into the hole
+static void bucket_remove(const Bucket B, int i) {
+    assert(i < B->n_voters);
+
+    B->n_voters--;
+    B->pins_array[i]   = B->pins_array[B->n_voters];
+    B->voters_array[i] = B->voters_array[B->n_voters];
+}
+
+// Swaps the entry at slot i of bucket A with the entry at slot j of bucket B
+static void bucket_swap_entries(const Bucket A, int i, const Bucket B, int j) {
+    int      pin = A->pins_array[i];
+    uint32_t v   = A->voters_array[i];
 
-    // Update the state of the bucket
-    bucket_to_empty->state = empty;
+    A->pins_array[i]   = B->pins_array[j];
+    A->voters_array[i] = B->voters_array[j];
+    B->pins_array[j]   = pin;
+    B->voters_array[j] = v;
 }
 
 // Destroys the list of buckets starting from bucket B. If count_bytes
@@ -180,51 +326,112 @@ static void bucket_list_destroy(const Bucket B, bool count_bytes) {
 }
 
 
+// ------------------------------ DIRECTORY ------------------------------ //
+
+// Returns the segment that the bucket at index belongs to
+static int segment_of(size_t index) {
+    if(index < ((size_t)1 << HASH_TABLE_SEGMENT_BITS))
+        return 0;
+    return (63 - __builtin_clzll(index)) - HASH_TABLE_SEGMENT_BITS + 1;
+}
+
+// Returns the number of buckets segment k holds
+static size_t segment_capacity(int k) {
+    return (size_t)1 << ((k == 0) ? HASH_TABLE_SEGMENT_BITS : HASH_TABLE_SEGMENT_BITS + k - 1);
+}
+
+// Returns the slot of the bucket at index, within its segment (which must exist)
+static Bucket* hash_table_slot(const HashTable H, size_t index) {
+    int k = segment_of(index);
+    size_t first = (k == 0) ? 0 : segment_capacity(k);      // segment k > 0 starts at its own capacity
+    return &H->segments[k][index - first];
+}
+
+// Returns the bucket at index
+static Bucket hash_table_bucket(const HashTable H, size_t index) {
+    return *hash_table_slot(H, index);
+}
+
+// Creates an empty bucket at index, allocating its segment first if needed
+static void hash_table_add_bucket(const HashTable H, size_t index) {
+    int k = segment_of(index);
+    if(H->segments[k] == NULL) {
+        H->segments[k] = malloc(sizeof(Bucket) * segment_capacity(k));
+        if(H->segments[k] == NULL) {
+            fprintf(stderr, "Error: Memory allocation failure | While allocating memory for: segment of hash_table.\n");
+            exit(EXIT_FAILURE);
+        }
+        __atomic_fetch_add(&H->segment_bytes, sizeof(Bucket) * segment_capacity(k), __ATOMIC_RELAXED);
+    }
+
+    // The slot is read without any lock by the prefetching stages of
+    // hash_table_mark_voters_voted, hence the atomic store
+    __atomic_store_n(hash_table_slot(H, index), bucket_create(H->b_size), __ATOMIC_RELAXED);
+    hash_table_count_chain(H, 0, 1);
+}
+
+// Takes out the bucket at index (the last one of the directory), and returns it.
+// The segment stays allocated, as the table is likely to grow back into it
+static Bucket hash_table_remove_bucket(const HashTable H, size_t index) {
+    Bucket B = hash_table_bucket(H, index);
+    __atomic_store_n(hash_table_slot(H, index), NULL, __ATOMIC_RELAXED);
+    return B;
+}
+
+
 // ------------------------------ HASH TABLE ------------------------------ //
 
 // ---------------- HASH TABLE HELPER FUNCTIONS ----------------- //
 
-// Initial insertion of voter V at H->buckets_array[index]
-static void hash_table_simple_insert(const HashTable H, const Voter V, size_t index) {
+// Initial insertion of the voter with the given pin and store index
+// (voter_index) at the bucket at index
+static void hash_table_simple_insert(const HashTable H, int pin, uint32_t voter_index, size_t index) {
     assert(H != NULL);
-    assert(V != NULL);
-    assert(index < H->size);
+    assert(voter_index != VOTER_NO_INDEX);
+    assert(index < shape_size(H, hash_table_shape(H)));
 
-    Bucket temp = H->buckets_array[index];
-    while(temp->state == full) {
-        if(temp->next != NULL)
+    Bucket temp = hash_table_bucket(H, index);
+    size_t length = 1;                                  // buckets of the chain up to temp
+    while(bucket_is_full(temp)) {
+        if(temp->next != NULL) {
             temp = temp->next;
+            length++;
+        }
         else {
             temp->next = bucket_create(H->b_size);      // overflow bucket
             temp = temp->next;
+            hash_table_count_chain(H, length, length + 1);
             break;
         }
     }
-    bucket_insert(temp, V);
+    bucket_insert(temp, pin, voter_index);
 }
 
 // Checks if a bucket split is needed
 static bool hash_table_split_needed(const HashTable H) {
     assert(H != NULL);
 
-    if(H->lambda > H->l_threshold)
+    if(calc_lambda(H) > H->l_threshold)
         return true;
     return false;
 }
 
-// Performs bucket split
-static void hash_table_split(const HashTable H) {
+// Checks if a bucket merge is needed (the table never shrinks below its initial size)
+static bool hash_table_merge_needed(const HashTable H) {
     assert(H != NULL);
 
-    H->size++;                                                                  // Increase number of non-overflown buckets
+    if(hash_table_shape(H) == 0)
+        return false;
+    return calc_lambda(H) < H->l_threshold * HASH_TABLE_MERGE_FACTOR;
+}
 
-    H->buckets_array = realloc(H->buckets_array, sizeof(Bucket) * H->size);     // Reallocate memory
-    if(H->buckets_array == NULL) {
-        fprintf(stderr, "Error: Memory reallocation failure | While reallocating memory for: buckets_array of hash_table.\n");
-        exit(EXIT_FAILURE);
-    }
+// Performs bucket split. No bucket moves: the new one takes the next
+// slot of the directory (the first slot of a new segment at times)
+static void hash_table_split(const HashTable H) {
+    assert(H != NULL);
 
-    H->buckets_array[H->size - 1] = bucket_create(H->b_size);                   // Create the new bucket at the end of the buckets_array
+    hash_table_add_bucket(H, H->size);                                          // Create the new bucket at the end of the directory
+    H->size++;                                                                  // Increase number of non-overflown buckets
 }
 
 // Resets p index, updates the round and the old size
@@ -236,77 +443,236 @@ static void hash_table_reset_p(const HashTable H) {
     H->size_old = H->size;      // Update the old size to be equal to the current size
 }
 
-// Returns a list of voters that need to be redistributed
-static List get_keys_for_redistribution(const HashTable H) {
+// Redistribution stage of insertion. It happens in place, without any allocations.
+// Note that a chain may have partially filled buckets before full ones (see step 2).
+//   1) The chain of bucket p is partitioned. Every voter that stays in bucket p
+//      (h_{i+1}(key) = p) is swapped towards the front of the chain, so that in the
+//      end the staying voters fill its first slots and the moving voters its last ones.
+//   2) The moving voters of the bucket where the staying ones end are copied into
+//      the new bucket, and every bucket after that one (holding only moving voters)
+//      is handed over to the new bucket as its overflow chain, as is.
+// Only the pins array is read to decide, so the voters themselves are never touched.
+static void hash_table_redistribution(const HashTable H) {
     assert(H != NULL);
 
-    Bucket temp = H->buckets_array[H->p_index];
-    Voter v;
-    List redistribute_keys_list = list_create(NULL, NULL, NULL);
-    do {
-        for(int i = 0; i < temp->b_size; i++) {
-            v = bucket_remove_voter(temp, i);
-            if(v == NULL)
-                break;
-            list_append(redistribute_keys_list, bucket_remove_voter(temp, i));
+    Bucket old_bucket = hash_table_bucket(H, H->p_index);
+    Bucket new_bucket = hash_table_bucket(H, H->size - 1);
+
+    // Partition: (write, w) is the slot right after the last staying voter
+    Bucket write = old_bucket;
+    int    w     = 0;
+    size_t old_length = 0, write_length = 1;           // buckets of the chain, and up to write
+    for(Bucket read = old_bucket; read != NULL; read = read->next) {
+        old_length++;
+        for(int r = 0; r < read->n_voters; r++) {
+            size_t h_i_plus_1 = hash_function(hash_key(H, read->pins_array[r]), H->round+1, H->init_size);
+            if(h_i_plus_1 != H->p_index)
+                continue;
+
+            if(w == write->n_voters) {
+                write = write->next;
+                write_length++;
+                w = 0;
+            }
+            bucket_swap_entries(write, w, read, r);
+            w++;
         }
-        temp = temp->next;
-    } while(temp != NULL);
+    }
+
+    // The moving voters of the write bucket fit in the (empty) new bucket,
+    // which comes first in its chain, partially filled or not
+    for(int i = w; i < write->n_voters; i++) {
+        new_bucket->pins_array[new_bucket->n_voters]   = write->pins_array[i];
+        new_bucket->voters_array[new_bucket->n_voters] = write->voters_array[i];
+        new_bucket->n_voters++;
+    }
+    write->n_voters = w;
+
+    // The rest of the chain only holds moving voters
+    new_bucket->next = write->next;
+    write->next = NULL;
+    hash_table_count_chain(H, old_length, write_length);
+    hash_table_count_chain(H, 1, 1 + old_length - write_length);
+
+    // Update the p index
+    H->p_index++;
+}
+
+
+// Returns the index of the bucket in which key belongs, given the round
+// and p index of shape
+static size_t hash_table_shape_address(const HashTable H, unsigned int key, uint64_t shape) {
+    int    round   = shape >> 32;
+    size_t p_index = (uint32_t)shape;
+
+    size_t h_i = hash_function(key, round, H->init_size);
+    if(h_i < p_index)
+        h_i = hash_function(key, round + 1, H->init_size);
 
-    return redistribute_keys_list;
+    return h_i;
 }
 
-// Destroys all overflown buckets of H->buckets_array[H->p_index]
-static void hash_table_destroy_overflown_buckets(const HashTable H) {
+// Returns the index of the bucket in which the key pin belongs, given
+// the current round and p index
+static size_t hash_table_address(const HashTable H, int pin) {
     assert(H != NULL);
 
-    Bucket buckets_to_delete = H->buckets_array[H->p_index]->next;
-    H->buckets_array[H->p_index]->next = NULL;
-    bucket_list_destroy(buckets_to_delete, false);
+    return hash_table_shape_address(H, hash_key(H, pin), hash_table_shape(H));
 }
 
-// Performs redistribution of the voters inside the list redistribute_keys_list
-static void hash_table_keys_redistribute(const HashTable H, List redistribute_keys_list) {
+// Finds the bucket in which the key pin belongs and locks its stripe, exclusively
+// or not, returning its index. Splits of other buckets may go on meanwhile, so
+// once the stripe is held the address is computed again: if it is still the same,
+// no split can move pin in or out of the bucket until the stripe is unlocked (a
+// split holds the stripes of both its buckets until it publishes the new shape).
+// Otherwise the bucket was split in between, and the new address is locked instead.
+static size_t hash_table_lock_bucket(const HashTable H, int pin, bool exclusive) {
+    unsigned int key = hash_key(H, pin);
+    size_t index = hash_table_shape_address(H, key, hash_table_shape(H));
+
+    while(true) {
+        pthread_rwlock_t* stripe = hash_table_stripe(H, index);
+        if(exclusive)
+            pthread_rwlock_wrlock(stripe);
+        else
+            pthread_rwlock_rdlock(stripe);
+
+        size_t current = hash_table_shape_address(H, key, hash_table_shape(H));
+        if(current == index)
+            return index;
+
+        pthread_rwlock_unlock(stripe);
+        index = current;
+    }
+}
+
+// Grows an empty table straight to size buckets, during the given round
+// (m * 2^round <= size < m * 2^(round+1)), with p at the matching index
+static void hash_table_set_shape(const HashTable H, size_t size, int round) {
     assert(H != NULL);
+    assert(is_hash_table_empty(H));
+    assert(size >= H->size);
+
+    for(size_t i = H->size; i < size; i++)
+        hash_table_add_bucket(H, i);
 
-    Voter v;
-    while(!is_list_empty(redistribute_keys_list)) {
-        v = list_remove(redistribute_keys_list);
-        int h_i_plus_1 = hash_function(voter_get_pin(v), H->round+1, H->init_size);
-        hash_table_simple_insert(H, v, h_i_plus_1);
+    H->size     = size;
+    H->round    = round;
+    H->size_old = H->init_size << round;
+    H->p_index  = size - H->size_old;
+    hash_table_publish_shape(H);
+}
+
+// Locks exclusively the stripes of the buckets at a and b. The stripes are locked
+// in order, so that two of them are never waited for the other way around
+static void hash_table_lock_pair(const HashTable H, size_t a, size_t b) {
+    pthread_rwlock_t* first  = hash_table_stripe(H, a);
+    pthread_rwlock_t* second = hash_table_stripe(H, b);
+    if(first > second) {
+        pthread_rwlock_t* temp = first;
+        first = second;
+        second = temp;
     }
-    
-    // Free allocated space from helper list
-    list_destroy(redistribute_keys_list, false);
+    pthread_rwlock_wrlock(first);
+    if(second != first)
+        pthread_rwlock_wrlock(second);
 }
 
-// Redistribution stage of insertion
-static void hash_table_redistribution(const HashTable H) {
+// Unlocks the stripes of the buckets at a and b, locked by hash_table_lock_pair
+static void hash_table_unlock_pair(const HashTable H, size_t a, size_t b) {
+    pthread_rwlock_t* first  = hash_table_stripe(H, a);
+    pthread_rwlock_t* second = hash_table_stripe(H, b);
+    if(second != first)
+        pthread_rwlock_unlock(second);
+    pthread_rwlock_unlock(first);
+}
+
+// Grows the table by one bucket: splits bucket p and redistributes its voters.
+// Only one split may run at a time (under split_lock, when the table is shared).
+// Lookups and inserts go on meanwhile, except for those of the two buckets
+// involved, whose stripes are held until the new shape is published
+static void hash_table_grow(const HashTable H) {
     assert(H != NULL);
 
-    // Get the voters we are going to redistribute
-    List redistribute_keys_list = get_keys_for_redistribution(H);
+    uint64_t start = now_ns();
+    size_t p_index = H->p_index, new_index = H->size;
+    hash_table_lock_pair(H, p_index, new_index);
+
+    // Splitting
+    hash_table_split(H);
+
+    // Redistribution
+    hash_table_redistribution(H);
+
+    // Check if the size has become double the old size. If
+    // so, reset the p index and update the old size
+    if (H->size == 2*H->size_old)
+        hash_table_reset_p(H);
 
-    // Empty the head bucket
-    bucket_empty(H->buckets_array[H->p_index]);
+    hash_table_publish_shape(H);
 
-    // Destroy any overflown buckets at that index
-    if(H->buckets_array[H->p_index]->next != NULL) {
-        hash_table_destroy_overflown_buckets(H);
+    hash_table_unlock_pair(H, p_index, new_index);
+
+    __atomic_fetch_add(&H->n_splits, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&H->split_ns, now_ns() - start, __ATOMIC_RELAXED);
+}
+
+
+// Shrinks the table by one bucket, undoing the last split: the last bucket of the
+// directory is merged back into the bucket it was split from, which becomes bucket p.
+// It runs under split_lock, like hash_table_grow, and holds the stripes of both
+// buckets until the new shape is published
+static void hash_table_shrink(const HashTable H) {
+    assert(H != NULL);
+    assert(H->size > H->init_size);
+
+    // Step back to the previous round, if p is at its start
+    if(H->p_index == 0) {
+        H->round--;
+        H->size_old = H->init_size << H->round;
+        H->p_index  = H->size_old;
+    }
+    size_t p_index = H->p_index - 1, last = H->size - 1;
+    hash_table_lock_pair(H, p_index, last);
+
+    // Every voter of the last bucket goes back to bucket p (h_i(key) = p),
+    // and the chain of the last bucket is freed
+    Bucket B = hash_table_remove_bucket(H, last);
+    size_t length = 0;
+    for(Bucket temp = B; temp != NULL; temp = temp->next) {
+        for(int i = 0; i < temp->n_voters; i++)
+            hash_table_simple_insert(H, temp->pins_array[i], temp->voters_array[i], p_index);
+        length++;
     }
+    bucket_list_destroy(B, false);
+    hash_table_count_chain(H, length, 0);
 
-    // Perform the redistribution
-    hash_table_keys_redistribute(H, redistribute_keys_list);
+    H->size--;
+    H->p_index = p_index;
+    hash_table_publish_shape(H);
 
-    // Update the p index
-    H->p_index++;
+    hash_table_unlock_pair(H, p_index, last);
+
+    __atomic_fetch_add(&H->n_merges, 1, __ATOMIC_RELAXED);
 }
 
 
 // -------------------- HASH TABLE FUNCTIONS -------------------- //
 
+bool hash_kind_from_name(const char* name, HashKind* hash_kind) {
+    if(strcmp(name, "modulo") == 0)
+        *hash_kind = HASH_MODULO;
+    else if(strcmp(name, "fibonacci") == 0)
+        *hash_kind = HASH_FIBONACCI;
+    else if(strcmp(name, "murmur") == 0)
+        *hash_kind = HASH_MURMUR;
+    else
+        return false;
+    return true;
+}
+
 // Constructor for the HashTable
-HashTable hash_table_create(int m, int bucket_size, float load_threshold) {
+HashTable hash_table_create(int m, int bucket_size, float load_threshold, HashKind hash_kind, const VoterStore S) {
     
     HashTable H =  malloc(sizeof(hash_table));
     if(H == NULL) {
@@ -319,83 +685,205 @@ HashTable hash_table_create(int m, int bucket_size, float load_threshold) {
     H->size_old     = m;
     H->b_size       = bucket_size;
     H->n_voters     = 0;
-    H->lambda       = 0.0;
     H->p_index      = 0;
     H->round        = 0;
     H->l_threshold    = load_threshold;
     H->n_voters_voted = 0;
+    H->hash_kind      = hash_kind;
+    H->store          = S;
 
-    H->buckets_array = malloc(sizeof(Bucket) * m);
-    if(H->buckets_array == NULL) {
-        fprintf(stderr, "Error: Memory allocation failure | While allocating memory for: buckets_array of hash_table.\n");
-        exit(EXIT_FAILURE);
-    }
+    H->n_chain_buckets = 0;
+    H->segment_bytes   = 0;
+    H->n_splits        = 0;
+    H->n_merges        = 0;
+    H->split_ns        = 0;
+    for(int i = 0; i < HASH_TABLE_STATS_CHAIN_BINS; i++)
+        H->chains[i] = 0;
 
+    for(int k = 0; k < HASH_TABLE_N_SEGMENTS; k++)
+        H->segments[k] = NULL;
 
     for(int i = 0; i < m; i++) {
-        H->buckets_array[i] = bucket_create(H->b_size);
+        hash_table_add_bucket(H, i);
     }
 
+    hash_table_publish_shape(H);
+    hash_table_locks_init(H);
+
     return H;
 }
 
-void hash_table_insert(const HashTable H, const Voter V) {
+// Grows an empty HashTable straight to the shape it would have after n_voters
+// insertions, so that a bulk load of that many voters performs no splits.
+// The table needs size buckets where n_voters / (size * b_size) does not
+// exceed the load threshold. A linear hashing table of that size is at
+// round r (the largest one with m * 2^r <= size), with p = size - m * 2^r
+// buckets of the round already split.
+void hash_table_reserve(const HashTable H, size_t n_voters) {
+    assert(H != NULL);
+    assert(is_hash_table_empty(H));
+
+    size_t size = (size_t)((double)n_voters / ((double)H->b_size * H->l_threshold));
+    while((float)n_voters / ((float)(size * H->b_size)) > H->l_threshold)
+        size++;
+    if(size <= H->size)
+        return;
+
+    int round = 0;
+    while(2 * (H->init_size << round) <= size)
+        round++;
+
+    hash_table_set_shape(H, size, round);
+}
+
+// Several threads may insert at once: each one holds the stripe lock of its bucket
+// exclusively (see hash_table_lock_bucket), so the check for the pin and the
+// insertion are atomic. The split the insertion may trigger runs once the stripe
+// is unlocked, under split_lock, and locks the stripes of the two buckets it
+// touches (see hash_table_lock_pair), so it runs alongside inserts and lookups of
+// every other bucket. Those that raced with it and computed the address of pin
+// with the old shape notice the new shape once they hold their stripe, and move on
+// to the right bucket. Since several threads may find a split needed at the same
+// time, the one that gets split_lock first splits and the rest re-check and back off.
+bool hash_table_insert(const HashTable H, const Voter V) {
     assert(H != NULL);
     assert(V != NULL);
 
     int pin = voter_get_pin(V);
 
-    // Calculate hash value of key
-    size_t h_i = hash_function(pin, H->round, H->init_size);
-    if(h_i < H->p_index)
-        h_i = hash_function(pin, H->round + 1, H->init_size);
+    // Initial insertion of key, unless it is already there
+    size_t index = hash_table_lock_bucket(H, pin, true);
+
+    bool exists = false;
+    for(Bucket temp = hash_table_bucket(H, index); temp != NULL && !exists; temp = temp->next)
+        exists = (bucket_search(temp, pin) != VOTER_NO_INDEX);
+    if(!exists) {
+        hash_table_simple_insert(H, pin, voter_get_index(V), index);
 
-    // Initial insertion of key
-    hash_table_simple_insert(H, V, h_i);
+        // Increase number of keys of hash table
+        __atomic_fetch_add(&H->n_voters, 1, __ATOMIC_RELAXED);
 
-    // Increase number of keys of hash table
-    H->n_voters++;
+        // Increase number of voters who have voted, if V has voted
+        if(voter_has_voted(V))
+            __atomic_fetch_add(&H->n_voters_voted, 1, __ATOMIC_RELAXED);
+    }
 
-    // Increase number of voters who have voted, if V has voted
-    if(voter_has_voted(V))
-        H->n_voters_voted++;
+    pthread_rwlock_unlock(hash_table_stripe(H, index));
 
-    // Update load factor right away
-    H->lambda = calc_lambda(H);
-    
     // Check if splitting is needed
-    if (hash_table_split_needed(H)) {
+    if (!exists && hash_table_split_needed(H)) {
+        pthread_mutex_lock(&H->split_lock);
+        if (hash_table_split_needed(H))
+            hash_table_grow(H);
+        pthread_mutex_unlock(&H->split_lock);
+    }
 
-        // Splitting
-        hash_table_split(H);
+    return !exists;
+}
 
-        // Redistribution
-        hash_table_redistribution(H);
+// Deletion takes the stripe lock of the bucket exclusively, like insertion does.
+// The hole left in the bucket is filled with its own last entry, and an overflow
+// bucket left empty is unlinked and freed at once (bytes_freed only counts what
+// is freed at exit, so it is left out). A merge the deletion may
+// trigger is performed under split_lock, as a split would be.
+Voter hash_table_delete(const HashTable H, int pin) {
+    assert(H != NULL);
 
-        // Check if the size has become double the old size. If
-        // so, reset the p index and update the old size
-        if (H->size == 2*H->size_old)
-            hash_table_reset_p(H);
+    size_t index = hash_table_lock_bucket(H, pin, true);
+
+    Voter V = NULL;
+    Bucket before = NULL;
+    size_t length = 1;                  // buckets of the chain up to temp
+    for(Bucket temp = hash_table_bucket(H, index); temp != NULL; before = temp, temp = temp->next, length++) {
+        int slot = pins_find(temp->pins_array, temp->n_voters, pin);
+        if(slot < 0)
+            continue;
+
+        V = voter_store_get(H->store, temp->voters_array[slot]);
+        bucket_remove(temp, slot);
+        if(temp->n_voters == 0 && before != NULL) {
+            before->next = temp->next;
+            bucket_destroy(temp, false);
+
+            for(Bucket rest = before->next; rest != NULL; rest = rest->next)
+                length++;
+            hash_table_count_chain(H, length, length - 1);
+        }
+        break;
+    }
+
+    if(V != NULL) {
+        // Decrease number of keys of hash table (and of voters who have voted)
+        __atomic_fetch_sub(&H->n_voters, 1, __ATOMIC_RELAXED);
+        if(voter_has_voted(V))
+            __atomic_fetch_sub(&H->n_voters_voted, 1, __ATOMIC_RELAXED);
     }
+
+    pthread_rwlock_unlock(hash_table_stripe(H, index));
+
+    // Check if merging is needed. A bucket holds several voters, so
+    // the table may have to shrink by more than one bucket to keep up
+    if (V != NULL && hash_table_merge_needed(H)) {
+        pthread_mutex_lock(&H->split_lock);
+        while (hash_table_merge_needed(H))
+            hash_table_shrink(H);
+        pthread_mutex_unlock(&H->split_lock);
+    }
+
+    return V;
+}
+
+size_t hash_table_n_buckets(const HashTable H) {
+    assert(H != NULL);
+
+    return H->size;
+}
+
+size_t hash_table_bucket_index(const HashTable H, int pin) {
+    assert(H != NULL);
+
+    return hash_table_address(H, pin);
+}
+
+bool hash_table_bulk_insert(const HashTable H, const Voter V) {
+    assert(H != NULL);
+    assert(V != NULL);
+
+    int pin = voter_get_pin(V);
+    size_t h_i = hash_table_address(H, pin);
+
+    for(Bucket temp = hash_table_bucket(H, h_i); temp != NULL; temp = temp->next) {
+        if(bucket_search(temp, pin) != VOTER_NO_INDEX)
+            return false;
+    }
+
+    hash_table_simple_insert(H, pin, voter_get_index(V), h_i);
+    return true;
+}
+
+void hash_table_bulk_finish(const HashTable H, size_t n_voters) {
+    assert(H != NULL);
+
+    H->n_voters += n_voters;
+
+    // Catch up with every split the insertions would have triggered
+    while (hash_table_split_needed(H))
+        hash_table_grow(H);
 }
 
 Voter hash_table_search(const HashTable H, int pin) {
     assert(H != NULL);
     assert(pin >= 0);
 
-    size_t h_i = hash_function(pin, H->round, H->init_size);
-    if (h_i < H->p_index)
-        h_i = hash_function(pin, H->round + 1, H->init_size);
+    size_t index = hash_table_lock_bucket(H, pin, false);
 
-    Bucket temp = H->buckets_array[h_i];
-    while(temp != NULL) {
-        Voter v = bucket_search(temp, pin);
-        if(v != NULL)
-            return v;
-        temp = temp->next;
-    }
+    uint32_t v = VOTER_NO_INDEX;
+    for(Bucket temp = hash_table_bucket(H, index); temp != NULL && v == VOTER_NO_INDEX; temp = temp->next)
+        v = bucket_search(temp, pin);
 
-    return NULL;
+    pthread_rwlock_unlock(hash_table_stripe(H, index));
+
+    return (v != VOTER_NO_INDEX) ? voter_store_get(H->store, v) : NULL;
 }
 
 bool hash_table_exists(const HashTable H, int pin) {
@@ -410,19 +898,19 @@ bool hash_table_exists(const HashTable H, int pin) {
 int hash_table_n_voters(const HashTable H) {
     assert(H != NULL);
 
-    return H->n_voters;
+    return __atomic_load_n(&H->n_voters, __ATOMIC_RELAXED);
 }
 
 bool is_hash_table_empty(const HashTable H) {
     assert(H != NULL);
 
-    return (H->n_voters == 0);
+    return (hash_table_n_voters(H) == 0);
 }
 
 int hash_table_n_voters_voted(const HashTable H) {
     assert(H != NULL);
 
-    return H->n_voters_voted;
+    return __atomic_load_n(&H->n_voters_voted, __ATOMIC_RELAXED);
 }
 
 Voter hash_table_mark_voter_voted(const HashTable H, int pin) {
@@ -431,22 +919,206 @@ Voter hash_table_mark_voter_voted(const HashTable H, int pin) {
 
     Voter v = hash_table_search(H, pin);
     if(v == NULL) {
-        printf("%d does not exist\n", pin);
+        output_printf("%d does not exist\n", pin);
         return NULL;
     }
-    if(!voter_has_voted(v)) {
-        voter_vote(v);
-        H->n_voters_voted++;
+    if(voter_vote(v)) {
+        __atomic_fetch_add(&H->n_voters_voted, 1, __ATOMIC_RELAXED);
         return v;
     }
-    printf("%d Marked Voted\n", pin);
+    output_printf("%d Marked Voted\n", pin);
     return NULL;
 }
 
+void hash_table_mark_voters_voted(const HashTable H, const int* pins, int n, Voter* voters, bool* marked) {
+    assert(H != NULL);
+    assert(n <= HASH_TABLE_BATCH_SIZE);
+
+    size_t indexes[HASH_TABLE_BATCH_SIZE];
+
+    // Stage 1: compute the address of every pin, and prefetch its slot
+    // of the directory
+    for(int i = 0; i < n; i++) {
+        indexes[i] = hash_table_address(H, pins[i]);
+        __builtin_prefetch(hash_table_slot(H, indexes[i]));
+    }
+
+    // Stage 2: prefetch the head bucket of every pin, along with its pins array
+    // (a bucket split or merge meanwhile only costs a wasted prefetch)
+    for(int i = 0; i < n; i++) {
+        Bucket B = __atomic_load_n(hash_table_slot(H, indexes[i]), __ATOMIC_RELAXED);
+        __builtin_prefetch(B);
+        __builtin_prefetch((const char*)B + bucket_bytes(H->b_size) - sizeof(int) * H->b_size);
+    }
+
+    // Stage 3: probe the chains, and prefetch every voter found (it's
+    // going to be written in the next stage)
+    for(int i = 0; i < n; i++) {
+        voters[i] = NULL;
+        indexes[i] = hash_table_lock_bucket(H, pins[i], false);
+        for(Bucket temp = hash_table_bucket(H, indexes[i]); temp != NULL; temp = temp->next) {
+            uint32_t v = bucket_search(temp, pins[i]);
+            if(v != VOTER_NO_INDEX) {
+                voters[i] = voter_store_get(H->store, v);
+                __builtin_prefetch(voters[i], 1);
+                break;
+            }
+        }
+        pthread_rwlock_unlock(hash_table_stripe(H, indexes[i]));
+    }
+
+    // Stage 4: mark the voters, in order (a pin appearing twice is
+    // only marked the first time). Voters never move, and are not
+    // deleted while voters are marked, so this needs no lock of the table
+    int n_marked = 0;
+    for(int i = 0; i < n; i++) {
+        marked[i] = (voters[i] != NULL && voter_vote(voters[i]));
+        n_marked += marked[i];
+    }
+    __atomic_fetch_add(&H->n_voters_voted, n_marked, __ATOMIC_RELAXED);
+}
+
+// Writes the table section of a snapshot: the shape of the table, the number
+// of voters in the chain of every bucket, and then the indices of those voters
+bool hash_table_save(const HashTable H, FILE* file) {
+    assert(H != NULL);
+
+    snapshot_table_header header = { 0 };
+    header.size           = H->size;
+    header.size_old       = H->size_old;
+    header.p_index        = H->p_index;
+    header.n_voters       = H->n_voters;
+    header.n_voters_voted = H->n_voters_voted;
+    header.init_size      = H->init_size;
+    header.b_size         = H->b_size;
+    header.round          = H->round;
+    header.hash_kind      = H->hash_kind;
+    header.l_threshold    = H->l_threshold;
+    if(!snapshot_write(file, &header, sizeof(header)))
+        return false;
+
+    for(size_t i = 0; i < H->size; i++) {
+        uint32_t count = 0;
+        for(Bucket temp = hash_table_bucket(H, i); temp != NULL; temp = temp->next)
+            count += temp->n_voters;
+        if(!snapshot_write(file, &count, sizeof(count)))
+            return false;
+    }
+    if(!snapshot_align(file))
+        return false;
+
+    // The buckets already hold the indices of their voters
+    for(size_t i = 0; i < H->size; i++) {
+        for(Bucket temp = hash_table_bucket(H, i); temp != NULL; temp = temp->next) {
+            if(!snapshot_write(file, temp->voters_array, sizeof(uint32_t) * temp->n_voters))
+                return false;
+        }
+    }
+    return snapshot_align(file);
+}
+
+// Checks if the header of a table section describes the shape of a table that
+// hash_table_set_shape can rebuild
+static bool snapshot_table_shape_is_valid(const snapshot_table_header* header) {
+    if(header->init_size <= 0 || header->b_size <= 0 || header->round < 0 || header->round >= 32
+        || header->hash_kind < HASH_MODULO || header->hash_kind > HASH_MURMUR || !(header->l_threshold > 0))
+        return false;
+
+    uint64_t size_old = (uint64_t)header->init_size << header->round;
+    return header->size_old == size_old
+        && header->p_index < size_old
+        && header->size == size_old + header->p_index
+        && header->n_voters_voted <= header->n_voters;
+}
+
+// Creates a HashTable out of the table section of a snapshot, with the voters of S.
+// Every chain is rebuilt as it was, without hashing any pin. The section is checked
+// as a whole first, and NULL is returned if it is truncated or corrupt
+HashTable hash_table_load(const char* section, size_t size, const VoterStore S) {
+    if(!snapshot_fits(size, 0, 1, sizeof(snapshot_table_header)))
+        return NULL;
+    const snapshot_table_header* header = (const snapshot_table_header*) section;
+    if(!snapshot_table_shape_is_valid(header) || !snapshot_fits(size, sizeof(*header), header->size, sizeof(uint32_t)))
+        return NULL;
+
+    const uint32_t* counts = (const uint32_t*)(header + 1);
+    size_t counts_bytes = (sizeof(uint32_t) * header->size + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT;
+    size_t entries_offset = sizeof(*header) + counts_bytes;
+
+    uint64_t n_entries = 0;
+    for(size_t i = 0; i < header->size; i++)
+        n_entries += counts[i];
+    if(n_entries != header->n_voters || !snapshot_fits(size, entries_offset, n_entries, sizeof(uint32_t)))
+        return NULL;
+
+    const uint32_t* entries = (const uint32_t*)(section + entries_offset);
+    size_t n_slots = voter_store_n_voters(S);
+    for(size_t i = 0; i < n_entries; i++) {
+        if(entries[i] >= n_slots)
+            return NULL;
+    }
+
+    HashTable H = hash_table_create(header->init_size, header->b_size, header->l_threshold, header->hash_kind, S);
+    hash_table_set_shape(H, header->size, header->round);
+    assert(H->p_index == header->p_index);
+
+    for(size_t i = 0; i < H->size; i++) {
+        for(uint32_t j = 0; j < counts[i]; j++, entries++)
+            hash_table_simple_insert(H, voter_get_pin(voter_store_get(S, *entries)), *entries, i);
+    }
+
+    H->n_voters       = header->n_voters;
+    H->n_voters_voted = header->n_voters_voted;
+
+    return H;
+}
+
+void hash_table_stats(const HashTable H, HashTableStats* stats) {
+    assert(H != NULL);
+    assert(stats != NULL);
+
+    uint64_t shape = hash_table_shape(H);
+    size_t n_chain_buckets = __atomic_load_n(&H->n_chain_buckets, __ATOMIC_RELAXED);
+
+    stats->n_buckets          = shape_size(H, shape);
+    stats->n_overflow_buckets = (n_chain_buckets > stats->n_buckets) ? n_chain_buckets - stats->n_buckets : 0;
+    for(int i = 0; i < HASH_TABLE_STATS_CHAIN_BINS; i++)
+        stats->chains[i] = __atomic_load_n(&H->chains[i], __ATOMIC_RELAXED);
+
+    stats->n_voters    = hash_table_n_voters(H);
+    stats->b_size      = H->b_size;
+    stats->round       = shape >> 32;
+    stats->p_index     = (uint32_t)shape;
+    stats->lambda      = (float)stats->n_voters / (float)(stats->n_buckets * H->b_size);
+    stats->l_threshold = H->l_threshold;
+    stats->n_splits    = __atomic_load_n(&H->n_splits, __ATOMIC_RELAXED);
+    stats->n_merges    = __atomic_load_n(&H->n_merges, __ATOMIC_RELAXED);
+    stats->split_ms    = (double)__atomic_load_n(&H->split_ns, __ATOMIC_RELAXED) / 1e6;
+    stats->bytes       = sizeof(hash_table) + __atomic_load_n(&H->segment_bytes, __ATOMIC_RELAXED)
+                       + n_chain_buckets * bucket_bytes(H->b_size);
+}
+
+void hash_table_print_stats(const HashTable H) {
+    assert(H != NULL);
+
+    HashTableStats stats;
+    hash_table_stats(H, &stats);
+
+    output_printf("Buckets: %zu (+%zu overflown), bucket size %d\n", stats.n_buckets, stats.n_overflow_buckets, stats.b_size);
+    output_printf("Chain lengths:");
+    for(int i = 0; i < HASH_TABLE_STATS_CHAIN_BINS; i++)
+        output_printf("%s %d%s: %zu", (i > 0) ? "," : "", i + 1, (i == HASH_TABLE_STATS_CHAIN_BINS - 1) ? "+" : "", stats.chains[i]);
+    output_printf("\n");
+    output_printf("Round: %d, p: %zu, load factor: %.4f (threshold %.4f)\n", stats.round, stats.p_index, stats.lambda, stats.l_threshold);
+    output_printf("Splits: %zu (%.3f ms), merges: %zu\n", stats.n_splits, stats.split_ms, stats.n_merges);
+    output_printf("Bytes: %zu (%.2f per voter)\n", stats.bytes,
+                  (stats.n_voters > 0) ? (double)stats.bytes / stats.n_voters : 0.0);
+}
+
 float hash_table_perc(const HashTable H) {
     assert(H != NULL);
 
-    return (((float)H->n_voters_voted)/ ((float)H->n_voters) )*100;
+    return (((float)hash_table_n_voters_voted(H))/ ((float)hash_table_n_voters(H)) )*100;
 }
 
 void hash_table_destroy(HashTable HT) {
@@ -454,10 +1126,14 @@ void hash_table_destroy(HashTable HT) {
         return;
 
     for(size_t i = 0; i< HT->size; i++)
-        bucket_list_destroy(HT->buckets_array[i], true);
+        bucket_list_destroy(hash_table_bucket(HT, i), true);
     
-    free(HT->buckets_array);
-    bytes_freed += sizeof(Bucket) * HT->size;
+    for(int k = 0; k < HASH_TABLE_N_SEGMENTS && HT->segments[k] != NULL; k++) {
+        free(HT->segments[k]);
+        bytes_freed += sizeof(Bucket) * segment_capacity(k);
+    }
+
+    hash_table_locks_destroy(HT);
 
     free(HT);
     HT = NULL;
@@ -474,16 +1150,16 @@ void hash_table_destroy(HashTable HT) {
 //     Bucket temp;
 //     int counter;
 //     for(size_t i = 0; i < HT->size; i++) {
-//         temp = HT->buckets_array[i];
+//         temp = hash_table_bucket(HT, i);
 //         printf("%ld:  ", i);
 //         do {
 //             printf("{ ");
 //             counter = 1;
 //             for(int j = 0; j < temp->b_size; j++) {
-//                 if(temp->voters_array[j] == NULL)
+//                 if(j >= temp->n_voters)
 //                     break;
-//                 printf("|%d|", voter_get_pin(temp->voters_array[j]));
-//                 if(counter != temp->b_size && temp->voters_array[counter] != NULL)
+//                 printf("|%d|", temp->pins_array[j]);
+//                 if(counter != temp->b_size && counter < temp->n_voters)
 //                     printf(", ");
 //                 counter++;
 //             }
@@ -493,5 +1169,5 @@ void hash_table_destroy(HashTable HT) {
 //         printf("\n");
 //     }
 //     printf("Round: %d\n", HT->round);
-//     printf("Load Factor: %f\n", HT->lambda);
+//     printf("Load Factor: %f\n", calc_lambda(HT));
 // }
@@ -1,27 +1,57 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <limits.h>
+#include <pthread.h>
 #include "../include/Voter.h"
 #include "../include/InvertedIndex.h"
-#include "../include/LinkedList.h"
+#include "../include/Snapshot.h"
+#include "../include/Output.h"
+
+#define ZIP_MAP_INITIAL_CAPACITY 64         // initial capacity of the zipcodes map (a power of two)
+#define ZIP_VOTERS_INITIAL_CAPACITY 4       // initial capacity of the voters array of a zipnode
 
 
 // ------------------------------ STRUCTS ------------------------------ //
 typedef struct zipcode_node* Zip;
+typedef struct count_group* Group;
 
 typedef struct zipcode_node {
-    int  postal_code;
-    List voters_list;
-    int  n_voters;
-    Zip  next;
-    Zip  back;
+    int    postal_code;
+    uint32_t* voters_array;     // the store indices of the voters who have voted, in the order they voted
+    int    n_voters;            // number of voters in voters_array
+    int    length;              // number of slots in use (a deleted voter leaves a VOTER_NO_INDEX hole)
+    int    capacity;            // number of slots of voters_array
+    Group  group;               // the group of zipnodes with n_voters voters
+    Zip    next;                // next zipnode within the group
+    Zip    back;                // previous zipnode within the group
 } zipcode_node;
 
 
+// The zipnodes are grouped by their number of voters, the same way an LFU cache
+// groups its entries by frequency. The groups form a list in decreasing order
+// of number of voters, and every group keeps its zipnodes in the order they
+// reached that number of voters. Thus, iterating the groups and then their
+// zipnodes visits the zipcodes in decreasing order of voters, and when the
+// number of voters of a zipnode increases, it only has to move to the end
+// of the neighbouring group.
+typedef struct count_group {
+    int   n_voters;             // the number of voters of every zipnode of the group
+    Zip   first;                // first zipnode of the group
+    Zip   last;                 // last zipnode of the group
+    Group next;                 // the group with the next smaller number of voters
+    Group back;                 // the group with the next bigger number of voters
+} count_group;
+
+
 typedef struct invterted_index {
-    Zip zipcodes_list_head;
-    Zip zipcodes_list_tail;
-    int n_zipcodes;
+    VoterStore store;               // the store the voters of the zipnodes are found in
+    Group  groups_head;             // the group with the most voters
+    Group  groups_tail;             // the group with the fewest voters
+    int    n_zipcodes;
+    Zip*   zipcodes_map;            // open addressing hash map from postal code to zipnode
+    size_t map_capacity;            // number of slots of zipcodes_map (a power of two)
+    pthread_rwlock_t lock;          // taken shared by the queries, and exclusively by the changes
 } invterted_index;
 
 
@@ -35,129 +65,335 @@ static Zip zipnode_create(int postal_code) {
         exit(EXIT_FAILURE);
     }
 
-    Z->postal_code = postal_code;
-    Z->voters_list = list_create(NULL, NULL, voter_print_pin);
-    Z->n_voters    = 0;
-    Z->next        = NULL;
-    Z->back        = NULL;
+    Z->postal_code  = postal_code;
+    Z->voters_array = NULL;
+    Z->n_voters     = 0;
+    Z->length       = 0;
+    Z->capacity     = 0;
+    Z->group        = NULL;
+    Z->next         = NULL;
+    Z->back         = NULL;
 
     return Z;
 }
 
-// Equality between two zipnodes: Z1 and Z2, means that the postal code of 
-// Z1 is the same with the postal code of Z2
-static bool zipnodes_equal(const Zip Z1, const Zip Z2) {
-    assert(Z1 != NULL);
-    assert(Z2 != NULL);
+// This function simply appends a voter into the voters_array of
+// a particular zipnode Z, doubling its capacity when it is full
+static void zipnode_insert(const Zip Z, const Voter V) {
+    assert(Z != NULL);
 
-    if(Z1->postal_code == Z2->postal_code)
-        return true;
-    
-    return false;
+    if(Z->length == Z->capacity) {
+        Z->capacity = (Z->capacity == 0) ? ZIP_VOTERS_INITIAL_CAPACITY : 2 * Z->capacity;
+        Z->voters_array = realloc(Z->voters_array, sizeof(uint32_t) * Z->capacity);
+        if(Z->voters_array == NULL) {
+            fprintf(stderr, "Error: Memory reallocation failure | While reallocating memory for: voters_array of zipcode_node.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    voter_set_zip_slot(V, Z->length);
+    Z->voters_array[Z->length++] = voter_get_index(V);
+    Z->n_voters++;
 }
 
-// Based on diff:
-//      Positive (+): Z1's number of voters is bigger than Z2's.   Returns  1
-//      Negative (-): Z1's number of voters is smaller than Z2's.  Returns -1
-//      Zero     (0): Z1's number of voters is the same with Z2's. Returns  0
-static int zipnodes_cmp_n_voters(const Zip Z1, const Zip Z2) {
-    assert(Z1 != NULL);
-    assert(Z2 != NULL);
+// Moves the voters of Z to the front of voters_array, closing the holes left by
+// deleted voters (the order of the voters is kept), and halves the capacity of
+// voters_array while it's at most a quarter full. The voters are found in S.
+// Only the capacity left is counted into bytes_freed, once Z is destroyed
+static void zipnode_compact(const Zip Z, const VoterStore S) {
+    assert(Z != NULL);
 
-    int diff = (Z1->n_voters) - (Z2->n_voters);
+    int length = 0;
+    for(int i = 0; i < Z->length; i++) {
+        if(Z->voters_array[i] == VOTER_NO_INDEX)
+            continue;
+        voter_set_zip_slot(voter_store_get(S, Z->voters_array[i]), length);
+        Z->voters_array[length++] = Z->voters_array[i];
+    }
+    Z->length = length;
+
+    int capacity = Z->capacity;
+    while(capacity > ZIP_VOTERS_INITIAL_CAPACITY && 4 * length <= capacity)
+        capacity /= 2;
+    if(capacity < Z->capacity) {
+        Z->voters_array = realloc(Z->voters_array, sizeof(uint32_t) * capacity);
+        if(Z->voters_array == NULL) {
+            fprintf(stderr, "Error: Memory reallocation failure | While reallocating memory for: voters_array of zipcode_node.\n");
+            exit(EXIT_FAILURE);
+        }
+        Z->capacity = capacity;
+    }
+}
+
+// Removes the voter V (of the store S) from Z in O(1), leaving a hole in its slot. Once
+// the holes outnumber the voters, the voters_array is compacted (in O(1) amortized time)
+static void zipnode_remove(const Zip Z, const Voter V, const VoterStore S) {
+    assert(Z != NULL);
 
-    if(diff > 0)
-        return 1;
+    unsigned int slot = voter_get_zip_slot(V);
+    assert((int)slot < Z->length && Z->voters_array[slot] == voter_get_index(V));
 
-    if(diff < 0)
-        return -1;
-    
-    return 0;
+    Z->voters_array[slot] = VOTER_NO_INDEX;
+    Z->n_voters--;
+
+    if(Z->length > 2 * Z->n_voters)
+        zipnode_compact(Z, S);
+}
+
+// Destroys the voters_array of Z (without the voters in it),
+// frees allocated space and adds that space into bytes_freed
+// global variable
+static void zipnode_destroy(const Zip Z) {
+    if(Z == NULL)
+        return;
+
+    free(Z->voters_array);
+    bytes_freed += sizeof(uint32_t) * Z->capacity;
+
+    free(Z);
+    bytes_freed += sizeof(zipcode_node);
 }
 
-// A simple search of zipnode with postal_code = zipcode
-static Zip zipcodes_list_search_zipnode(const Zip Z, int zipcode) {
-    Zip temp = Z;
-    while(temp != NULL) {
-        if(temp->postal_code == zipcode)
-            return temp;
-        temp = temp->next;
+// ------------------------------ COUNT GROUPS ------------------------------ //
+
+// Creates an empty group for zipnodes with n_voters voters, and links it
+// into the groups list of INV_INDEX, right after the group back (or at the
+// head of the list, if back is NULL)
+static Group group_create(const InvertedIndex INV_INDEX, int n_voters, Group back) {
+    Group G = malloc(sizeof(count_group));
+    if(G == NULL) {
+        fprintf(stderr, "Error: Memory allocation failure | While allocating memory for: count_group.\n");
+        exit(EXIT_FAILURE);
     }
-    return NULL;
+
+    G->n_voters = n_voters;
+    G->first    = NULL;
+    G->last     = NULL;
+    G->back     = back;
+    G->next     = (back != NULL) ? back->next : INV_INDEX->groups_head;
+
+    if(G->back != NULL)
+        G->back->next = G;
+    else
+        INV_INDEX->groups_head = G;
+
+    if(G->next != NULL)
+        G->next->back = G;
+    else
+        INV_INDEX->groups_tail = G;
+
+    return G;
 }
 
-// This is a function that implements sorted insert of Z, it works like this:
-// Starting from start (which will be Z->back), iterate backwards (towards the head).
-// At the first time a zipnode is found with greater or equal number of voters than Z,
-// say zipnode temp, perform the insertion of Z in-between temp and temp->next. If the
-// iteration ends without performing the insertion that means we have reached the head
-// and in this case once inserting Z at the back of the head, we shall update the list's
-// head as well.
-static void zipcodes_list_sorted_insert_left(Zip* head, Zip start, Zip Z) {
-    assert(start != NULL);
-    assert(Z != NULL);
+// Unlinks the (empty) group G from the groups list of INV_INDEX and frees it
+static void group_destroy(const InvertedIndex INV_INDEX, Group G) {
+    assert(G->first == NULL);
 
-    Zip temp = start;
-    Z->back = NULL;                         // we no longer need the Z->back pointer since we have temp pointer
-    while(temp->back != NULL) {
-        if(zipnodes_cmp_n_voters(temp, Z) >= 0) {           // At the first time a zipnode with greater or equal
-            Z->next = temp->next;                           // number of voters is found
-            Z->next->back = Z;                              // Place Z in front of it (the temp node), whilst
-            temp->next = Z;                                 // maintaining the general structure
-            Z->back = temp;
-            return;
-        }
-        temp = temp->back;
+    if(G->back != NULL)
+        G->back->next = G->next;
+    else
+        INV_INDEX->groups_head = G->next;
+
+    if(G->next != NULL)
+        G->next->back = G->back;
+    else
+        INV_INDEX->groups_tail = G->back;
+
+    free(G);
+    bytes_freed += sizeof(count_group);
+}
+
+// Appends the zipnode Z at the end of the group G
+static void group_append(const Group G, const Zip Z) {
+    Z->group = G;
+    Z->next  = NULL;
+    Z->back  = G->last;
+
+    if(G->last != NULL)
+        G->last->next = Z;
+    else
+        G->first = Z;
+    G->last = Z;
+}
+
+// Unlinks the zipnode Z from its group
+static void group_remove(const Zip Z) {
+    Group G = Z->group;
+
+    if(Z->back != NULL)
+        Z->back->next = Z->next;
+    else
+        G->first = Z->next;
+
+    if(Z->next != NULL)
+        Z->next->back = Z->back;
+    else
+        G->last = Z->back;
+
+    Z->group = NULL;
+    Z->next  = NULL;
+    Z->back  = NULL;
+}
+
+// Moves the zipnode Z, whose number of voters has just increased by one, to the
+// end of the group of its new number of voters. That group is either the one
+// right before its old group, or a new one created in-between. Takes O(1).
+static void group_promote(const InvertedIndex INV_INDEX, const Zip Z) {
+    Group old_group = Z->group;
+    Group back      = (old_group != NULL) ? old_group->back : INV_INDEX->groups_tail;
+
+    Group new_group = back;
+    if(new_group == NULL || new_group->n_voters != Z->n_voters)
+        new_group = group_create(INV_INDEX, Z->n_voters, back);
+
+    if(old_group != NULL) {
+        group_remove(Z);
+        if(old_group->first == NULL)
+            group_destroy(INV_INDEX, old_group);
     }
 
-    // We have reached the head node
-    if(zipnodes_cmp_n_voters(temp, Z) >= 0) {
-        temp->next->back = Z;
-        Z->next = temp->next;
-        Z->back = temp;
-        temp->next = Z;
+    group_append(new_group, Z);
+}
+
+// Moves the zipnode Z, whose number of voters has just decreased by one, to the
+// end of the group of its new number of voters (the one right after its old group,
+// or a new one created in-between). A zipnode left without voters leaves the groups.
+static void group_demote(const InvertedIndex INV_INDEX, const Zip Z) {
+    Group old_group = Z->group;
+
+    Group new_group = NULL;
+    if(Z->n_voters > 0) {
+        new_group = old_group->next;
+        if(new_group == NULL || new_group->n_voters != Z->n_voters)
+            new_group = group_create(INV_INDEX, Z->n_voters, old_group);
     }
-    else {
-        temp->back = Z;
-        Z->next = temp;
-        *head = Z;                                              // we have to update the head
+
+    group_remove(Z);
+    if(old_group->first == NULL)
+        group_destroy(INV_INDEX, old_group);
+
+    if(new_group != NULL)
+        group_append(new_group, Z);
+}
+
+
+// ------------------------------ ZIPCODES MAP ------------------------------ //
+
+// Returns the first slot of zipcode within a map of the given capacity. The
+// postal code is scrambled first, since postal codes are mostly consecutive
+static size_t zip_map_slot(int zipcode, size_t capacity) {
+    unsigned int key = (unsigned int)zipcode;
+    key ^= key >> 16;
+    key *= 0x85ebca6b;
+    key ^= key >> 13;
+    key *= 0xc2b2ae35;
+    key ^= key >> 16;
+
+    return key & (capacity - 1);
+}
+
+// Allocates an empty map with the given capacity
+static Zip* zip_map_create(size_t capacity) {
+    Zip* map = calloc(capacity, sizeof(Zip));
+    if(map == NULL) {
+        fprintf(stderr, "Error: Memory allocation failure | While allocating memory for: zipcodes_map.\n");
+        exit(EXIT_FAILURE);
     }
+    return map;
 }
 
+// Places Z in the first free slot of its probe sequence, within map
+static void zip_map_place(Zip* map, size_t capacity, const Zip Z) {
+    size_t slot = zip_map_slot(Z->postal_code, capacity);
+    while(map[slot] != NULL)
+        slot = (slot + 1) & (capacity - 1);
 
-// This function simply inserts a voter into the voters_list of
-// a particular zipnode Z
-static void zipnode_insert(const Zip Z, const Voter V) {
-    assert(Z != NULL);
+    map[slot] = Z;
+}
 
-    list_append(Z->voters_list, V);
-    Z->n_voters++;
+// Searches for the zipnode with postal_code = zipcode, in O(1) on average
+static Zip zip_map_search(const InvertedIndex INV_INDEX, int zipcode) {
+    size_t slot = zip_map_slot(zipcode, INV_INDEX->map_capacity);
+    while(INV_INDEX->zipcodes_map[slot] != NULL) {
+        if(INV_INDEX->zipcodes_map[slot]->postal_code == zipcode)
+            return INV_INDEX->zipcodes_map[slot];
+        slot = (slot + 1) & (INV_INDEX->map_capacity - 1);
+    }
+    return NULL;
 }
 
-// Destroys the voters_list of Z (without the voters in it),
-// frees allocated space and adds that space into bytes_freed
-// global variable
-static void zipnode_destroy(const Zip Z) {
-    if(Z == NULL)
-        return;
+// Adds the (new) zipnode Z into the map, doubling its capacity
+// whenever it becomes more than half full
+static void zip_map_insert(const InvertedIndex INV_INDEX, const Zip Z) {
+    if(2 * (INV_INDEX->n_zipcodes + 1) > (int)INV_INDEX->map_capacity) {
+        size_t capacity = 2 * INV_INDEX->map_capacity;
+        Zip* map = zip_map_create(capacity);
 
-    list_destroy(Z->voters_list, true);
+        for(size_t i = 0; i < INV_INDEX->map_capacity; i++) {
+            if(INV_INDEX->zipcodes_map[i] != NULL)
+                zip_map_place(map, capacity, INV_INDEX->zipcodes_map[i]);
+        }
 
-    free(Z);
-    bytes_freed += sizeof(zipcode_node);
+        free(INV_INDEX->zipcodes_map);
+        INV_INDEX->zipcodes_map = map;
+        INV_INDEX->map_capacity = capacity;
+    }
+
+    zip_map_place(INV_INDEX->zipcodes_map, INV_INDEX->map_capacity, Z);
+    INV_INDEX->n_zipcodes++;
+}
+
+// Takes the zipnode Z out of the map. The zipnodes after it in the same run of
+// the map are shifted back, so that no probe sequence is broken by the hole
+static void zip_map_remove(const InvertedIndex INV_INDEX, const Zip Z) {
+    size_t mask = INV_INDEX->map_capacity - 1;
+    Zip*   map  = INV_INDEX->zipcodes_map;
+
+    size_t hole = zip_map_slot(Z->postal_code, INV_INDEX->map_capacity);
+    while(map[hole] != Z)
+        hole = (hole + 1) & mask;
+    map[hole] = NULL;
+
+    for(size_t slot = (hole + 1) & mask; map[slot] != NULL; slot = (slot + 1) & mask) {
+        // The zipnode may fill the hole only if its own first slot
+        // is not (cyclically) within (hole, slot]
+        size_t first = zip_map_slot(map[slot]->postal_code, INV_INDEX->map_capacity);
+        if(((slot - first) & mask) < ((slot - hole) & mask))
+            continue;
+
+        map[hole] = map[slot];
+        map[slot] = NULL;
+        hole = slot;
+    }
+
+    INV_INDEX->n_zipcodes--;
+}
+
+
+// Prints the line of the zipnode Z: its postal code and its number of voters
+static void zipnode_print(const Zip Z) {
+    output_int(Z->postal_code);
+    output_write(" ", 1);
+    output_int(Z->n_voters);
+    output_write("\n", 1);
 }
 
+
 // ------------------------------ INVERTED INDEX ------------------------------ //
-InvertedIndex inv_index_create(void) {
+InvertedIndex inv_index_create(const VoterStore S) {
     InvertedIndex INV_INDEX = malloc(sizeof(invterted_index));
     if(INV_INDEX == NULL) {
         fprintf(stderr, "Error: Memory allocation failure | While allocating memory for: zipcode_node.\n");
         exit(EXIT_FAILURE);
     }
 
-    INV_INDEX->n_zipcodes         = 0;
-    INV_INDEX->zipcodes_list_head = NULL;
-    INV_INDEX->zipcodes_list_tail = NULL;
+    INV_INDEX->store        = S;
+    INV_INDEX->n_zipcodes   = 0;
+    INV_INDEX->groups_head  = NULL;
+    INV_INDEX->groups_tail  = NULL;
+    INV_INDEX->map_capacity = ZIP_MAP_INITIAL_CAPACITY;
+    INV_INDEX->zipcodes_map = zip_map_create(ZIP_MAP_INITIAL_CAPACITY);
+    pthread_rwlock_init(&INV_INDEX->lock, NULL);
     
     return INV_INDEX;
 }
@@ -173,96 +409,211 @@ void inv_index_insert(const InvertedIndex INV_INDEX, const Voter V) {
 
     int zip = voter_get_zip(V);
 
-    // In this case, zipcodes_list is empty
-    if(INV_INDEX->zipcodes_list_head == NULL) {
-        INV_INDEX->zipcodes_list_head = zipnode_create(zip);
-        zipnode_insert(INV_INDEX->zipcodes_list_head, V);
-        INV_INDEX->zipcodes_list_tail = INV_INDEX->zipcodes_list_head;
-        return;
-    }
-    
-    // Search for the zipnode
-    Zip zipnode = zipcodes_list_search_zipnode(INV_INDEX->zipcodes_list_head, zip);
+    pthread_rwlock_wrlock(&INV_INDEX->lock);
 
-    // In this case, zipnode wasn't found, therefore
-    // the new zipnode we are going to insert will 
-    // have number of voters <= than the number of voters in head
+    // Search for the zipnode, and create it if it doesn't exist yet
+    Zip zipnode = zip_map_search(INV_INDEX, zip);
     if(zipnode == NULL) {
-        Zip new_zipnode = zipnode_create(zip);
-        zipnode_insert(new_zipnode, V);
-        INV_INDEX->zipcodes_list_tail->next = new_zipnode;
-        new_zipnode->back = INV_INDEX->zipcodes_list_tail;
-        INV_INDEX->zipcodes_list_tail = new_zipnode;
-        return;
+        zipnode = zipnode_create(zip);
+        zip_map_insert(INV_INDEX, zipnode);
     }
 
-    // This is an easy case, as we only have to insert the voter V
-    // into the head node (the reason is pretty trivial)
-    if(zipnodes_equal(INV_INDEX->zipcodes_list_head, zipnode)) {
-        zipnode_insert(INV_INDEX->zipcodes_list_head, V);
-        return;
-    }
+    // Insert the voter, and move the zipnode to the group of its new
+    // number of voters, keeping the zipcodes in decreasing order
+    zipnode_insert(zipnode, V);
+    group_promote(INV_INDEX, zipnode);
 
-    // In this case, the zipnode is the same with the tail zipnode
-    if(zipnodes_equal(INV_INDEX->zipcodes_list_tail, zipnode)) {
-        zipnode_insert(INV_INDEX->zipcodes_list_tail, V);
-
-        Zip before_tail = INV_INDEX->zipcodes_list_tail->back;
-        // Before-tail node has fewer voters than the updated n_voters of tail
-        if(zipnodes_cmp_n_voters(INV_INDEX->zipcodes_list_tail, before_tail) > 0) {
-            before_tail->next = NULL;
-            zipcodes_list_sorted_insert_left(&INV_INDEX->zipcodes_list_head, before_tail, INV_INDEX->zipcodes_list_tail);
-            // Update the tail
-            INV_INDEX->zipcodes_list_tail = before_tail;
-        }
-        return;
-    }
+    pthread_rwlock_unlock(&INV_INDEX->lock);
+}
 
-    zipnode_insert(zipnode, V);
-    if(zipnodes_cmp_n_voters(zipnode, zipnode->back) > 0) {
-        // "removing" zipnode safely, maintaining the structure
-        zipnode->back->next = zipnode->next;
-        zipnode->next->back = zipnode->back;
-        zipnode->next = NULL;
+void inv_index_remove(const InvertedIndex INV_INDEX, const Voter V) {
+    assert(INV_INDEX != NULL);
+    assert(V != NULL);
 
-        zipcodes_list_sorted_insert_left(&INV_INDEX->zipcodes_list_head, zipnode->back, zipnode);
-        return;
+    pthread_rwlock_wrlock(&INV_INDEX->lock);
+
+    Zip zipnode = zip_map_search(INV_INDEX, voter_get_zip(V));
+    assert(zipnode != NULL);
+
+    // Remove the voter, and move the zipnode to the group of its new
+    // number of voters. A zipcode left without voters is dropped
+    zipnode_remove(zipnode, V, INV_INDEX->store);
+    group_demote(INV_INDEX, zipnode);
+    if(zipnode->n_voters == 0) {
+        zip_map_remove(INV_INDEX, zipnode);
+        zipnode_destroy(zipnode);
     }
+
+    pthread_rwlock_unlock(&INV_INDEX->lock);
 }
 
 void inv_index_n_voters_zipcode(const InvertedIndex INV_INDEX, int zipcode) {
     assert(INV_INDEX != NULL);
 
-    Zip z = zipcodes_list_search_zipnode(INV_INDEX->zipcodes_list_head, zipcode);
+    pthread_rwlock_rdlock(&INV_INDEX->lock);
+
+    Zip z = zip_map_search(INV_INDEX, zipcode);
     if(z != NULL) {
-        printf("%d voted in %d\n", z->n_voters, zipcode);
-        list_print(z->voters_list);
+        output_printf("%d voted in %d\n", z->n_voters, zipcode);
+        for(int i = 0; i < z->length; i++) {
+            if(z->voters_array[i] != VOTER_NO_INDEX)
+                voter_print_pin(voter_store_get(INV_INDEX->store, z->voters_array[i]));
+        }
     }
+
+    pthread_rwlock_unlock(&INV_INDEX->lock);
 }
 
 void inv_index_zipcodes_n_voters(const InvertedIndex INV_INDEX) {
     assert(INV_INDEX != NULL);
 
-    Zip temp = INV_INDEX->zipcodes_list_head;
-    while(temp != NULL) {
-        printf("%d %d\n", temp->postal_code, temp->n_voters);
-        temp = temp->next;
+    pthread_rwlock_rdlock(&INV_INDEX->lock);
+    for(Group group = INV_INDEX->groups_head; group != NULL; group = group->next) {
+        for(Zip temp = group->first; temp != NULL; temp = temp->next)
+            zipnode_print(temp);
     }
+    pthread_rwlock_unlock(&INV_INDEX->lock);
+}
+
+void inv_index_top_zipcodes(const InvertedIndex INV_INDEX, int k) {
+    assert(INV_INDEX != NULL);
+
+    // The groups are already in decreasing order, so only
+    // the first k zipnodes are ever visited
+    pthread_rwlock_rdlock(&INV_INDEX->lock);
+    for(Group group = INV_INDEX->groups_head; group != NULL && k > 0; group = group->next) {
+        for(Zip temp = group->first; temp != NULL && k > 0; temp = temp->next, k--)
+            zipnode_print(temp);
+    }
+    pthread_rwlock_unlock(&INV_INDEX->lock);
+}
+
+// Writes the index section of a snapshot: the zipcodes in decreasing
+// order of voters, followed by the indices of their voters
+bool inv_index_save(const InvertedIndex INV_INDEX, FILE* file) {
+    assert(INV_INDEX != NULL);
+
+    pthread_rwlock_rdlock(&INV_INDEX->lock);
+
+    snapshot_index_header header = { 0, 0 };
+    for(Group group = INV_INDEX->groups_head; group != NULL; group = group->next) {
+        for(Zip temp = group->first; temp != NULL; temp = temp->next) {
+            header.n_zipcodes++;
+            header.n_entries += temp->n_voters;
+        }
+    }
+    bool written = snapshot_write(file, &header, sizeof(header));
+
+    for(Group group = INV_INDEX->groups_head; written && group != NULL; group = group->next) {
+        for(Zip temp = group->first; written && temp != NULL; temp = temp->next) {
+            snapshot_zipcode record = { temp->postal_code, temp->n_voters };
+            written = snapshot_write(file, &record, sizeof(record));
+        }
+    }
+
+    // The zipnodes already hold the indices of their voters, so those without
+    // holes are written at once
+    for(Group group = INV_INDEX->groups_head; written && group != NULL; group = group->next) {
+        for(Zip temp = group->first; written && temp != NULL; temp = temp->next) {
+            if(temp->length == temp->n_voters) {
+                written = snapshot_write(file, temp->voters_array, sizeof(uint32_t) * temp->length);
+                continue;
+            }
+            for(int i = 0; written && i < temp->length; i++) {
+                if(temp->voters_array[i] != VOTER_NO_INDEX)
+                    written = snapshot_write(file, &temp->voters_array[i], sizeof(uint32_t));
+            }
+        }
+    }
+    written = written && snapshot_align(file);
+
+    pthread_rwlock_unlock(&INV_INDEX->lock);
+
+    return written;}
+
+// Loads the index section of a snapshot into the empty INV_INDEX. Since the zipcodes
+// come in decreasing order of voters, each one is simply appended to the last group.
+// The section is checked as a whole before anything is loaded out of it
+bool inv_index_load(const InvertedIndex INV_INDEX, const char* section, size_t size) {
+    assert(INV_INDEX != NULL);
+    assert(INV_INDEX->n_zipcodes == 0);
+
+    if(!snapshot_fits(size, 0, 1, sizeof(snapshot_index_header)))
+        return false;
+    const snapshot_index_header* header = (const snapshot_index_header*) section;
+    if(!snapshot_fits(size, sizeof(*header), header->n_zipcodes, sizeof(snapshot_zipcode)))
+        return false;
+    const snapshot_zipcode* zipcodes = (const snapshot_zipcode*)(header + 1);
+
+    // Every zipcode has voters, and no more than the one before it
+    uint64_t n_entries = 0;
+    for(size_t i = 0; i < header->n_zipcodes; i++) {
+        if(zipcodes[i].n_voters == 0 || zipcodes[i].n_voters > INT_MAX
+            || (i > 0 && zipcodes[i].n_voters > zipcodes[i-1].n_voters))
+            return false;
+        n_entries += zipcodes[i].n_voters;
+    }
+    size_t entries_offset = sizeof(*header) + sizeof(snapshot_zipcode) * header->n_zipcodes;
+    if(n_entries != header->n_entries || !snapshot_fits(size, entries_offset, n_entries, sizeof(uint32_t)))
+        return false;
+
+    const uint32_t* entries = (const uint32_t*)(section + entries_offset);
+    size_t n_slots = voter_store_n_voters(INV_INDEX->store);
+    for(size_t i = 0; i < n_entries; i++) {
+        if(entries[i] >= n_slots)
+            return false;
+    }
+
+    for(size_t i = 0; i < header->n_zipcodes; i++) {
+        Zip Z = zipnode_create(zipcodes[i].postal_code);
+
+        Z->capacity     = zipcodes[i].n_voters;
+        Z->voters_array = malloc(sizeof(uint32_t) * Z->capacity);
+        if(Z->voters_array == NULL) {
+            fprintf(stderr, "Error: Memory allocation failure | While allocating memory for: voters_array of zipcode_node.\n");
+            exit(EXIT_FAILURE);
+        }
+        for(int j = 0; j < Z->capacity; j++) {
+            Z->voters_array[j] = *entries++;
+            voter_set_zip_slot(voter_store_get(INV_INDEX->store, Z->voters_array[j]), j);
+        }
+        Z->n_voters = Z->capacity;
+        Z->length   = Z->capacity;
+
+        Group group = INV_INDEX->groups_tail;
+        if(group == NULL || group->n_voters != Z->n_voters)
+            group = group_create(INV_INDEX, Z->n_voters, INV_INDEX->groups_tail);
+        group_append(group, Z);
+
+        zip_map_insert(INV_INDEX, Z);
+    }
+
+    return true;
 }
 
 void inv_index_destroy(const InvertedIndex INV_INDEX) {
     if(INV_INDEX == NULL)
         return;
     
-    Zip temp = INV_INDEX->zipcodes_list_head;
-    Zip temp_before = INV_INDEX->zipcodes_list_head;
+    Group group = INV_INDEX->groups_head;
+    while(group != NULL) {
+        Zip temp = group->first;
+        while(temp != NULL) {
+            Zip next = temp->next;
+            zipnode_destroy(temp);
+            temp = next;
+        }
 
-    while (temp != NULL) {
-        temp = temp->next;
-        zipnode_destroy(temp_before);
-        temp_before = temp;
+        Group next_group = group->next;
+        free(group);
+        bytes_freed += sizeof(count_group);
+        group = next_group;
     }
-    zipnode_destroy(temp_before);
+
+    free(INV_INDEX->zipcodes_map);
+    bytes_freed += sizeof(Zip) * INV_INDEX->map_capacity;
+
+    pthread_rwlock_destroy(&INV_INDEX->lock);
     
     free(INV_INDEX);
     bytes_freed += sizeof(invterted_index);
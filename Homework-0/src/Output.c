@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "../include/Output.h"
+
+#define OUTPUT_BUFFER_SIZE (1 << 16)    // bytes gathered before they are handed over at once
+
+
+// The output of every thread: its sink (stdout while it's NULL), and the buffer
+// the lines printed are formatted into, until they are flushed
+static __thread OutputSink sink         = NULL;
+static __thread Pointer    sink_context = NULL;
+static __thread char*      buffer       = NULL;
+static __thread size_t     buffer_size  = 0;
+
+static pthread_once_t at_exit_once = PTHREAD_ONCE_INIT;
+
+
+// ------------------------------ OUTPUT UTILS ------------------------------ //
+
+// Writes size bytes of data to stdout, retrying until all of them are written
+static void stdout_write(const char* data, size_t size) {
+    while(size > 0) {
+        ssize_t written = write(STDOUT_FILENO, data, size);
+        if(written < 0) {
+            if(errno == EINTR)
+                continue;
+            return;         // like printf, the output is dropped if stdout is gone
+        }
+        data += written;
+        size -= written;
+    }
+}
+
+// Hands size bytes of data over to the sink of the calling thread
+static void sink_write(const char* data, size_t size) {
+    if(size == 0)
+        return;
+
+    if(sink == NULL)
+        stdout_write(data, size);
+    else
+        sink(data, size, sink_context);
+}
+
+// Flushes the output of the main thread when the program exits, so that
+// nothing printed is lost on an exit(EXIT_FAILURE)
+static void output_register_at_exit(void) {
+    atexit(output_flush);
+}
+
+// Allocates the buffer of the calling thread
+static void output_buffer_create(void) {
+    buffer = malloc(OUTPUT_BUFFER_SIZE);
+    if(buffer == NULL) {
+        fprintf(stderr, "Error: Memory allocation failure | While allocating memory for: output buffer.\n");
+        exit(EXIT_FAILURE);
+    }
+    buffer_size = 0;
+    pthread_once(&at_exit_once, output_register_at_exit);
+}
+
+
+// ------------------------------ OUTPUT ------------------------------ //
+void output_set_sink(OutputSink new_sink, Pointer context) {
+    output_flush();
+
+    sink         = new_sink;
+    sink_context = context;
+}
+
+void output_printf(const char* format, ...) {
+    if(buffer == NULL)
+        output_buffer_create();
+
+    va_list args, retry;
+    va_start(args, format);
+    va_copy(retry, args);
+
+    size_t space = OUTPUT_BUFFER_SIZE - buffer_size;
+    int len = vsnprintf(buffer + buffer_size, space, format, args);
+    va_end(args);
+
+    if(len >= 0 && (size_t)len < space)
+        buffer_size += len;
+    else if(len >= 0) {
+        // The line didn't fit: flush what's before it, and format it again,
+        // into the empty buffer if it fits there, or on its own otherwise
+        output_flush();
+        if(len < OUTPUT_BUFFER_SIZE)
+            buffer_size = vsnprintf(buffer, OUTPUT_BUFFER_SIZE, format, retry);
+        else {
+            char* long_line = malloc(len + 1);
+            if(long_line == NULL) {
+                fprintf(stderr, "Error: Memory allocation failure | While allocating memory for: output line.\n");
+                exit(EXIT_FAILURE);
+            }
+            vsnprintf(long_line, len + 1, format, retry);
+            sink_write(long_line, len);
+            free(long_line);
+        }
+    }
+    va_end(retry);
+}
+
+void output_write(const char* data, size_t size) {
+    if(buffer == NULL)
+        output_buffer_create();
+
+    if(size > OUTPUT_BUFFER_SIZE - buffer_size) {
+        output_flush();
+        if(size > OUTPUT_BUFFER_SIZE) {
+            sink_write(data, size);
+            return;
+        }
+    }
+    memcpy(buffer + buffer_size, data, size);
+    buffer_size += size;
+}
+
+// Formats the digits from the last one backwards, without going through vsnprintf
+void output_int(int value) {
+    char digits[12];
+    char* first = digits + sizeof(digits);
+    unsigned int magnitude = (value < 0) ? -(unsigned int)value : (unsigned int)value;
+
+    do {
+        *--first = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while(magnitude > 0);
+    if(value < 0)
+        *--first = '-';
+
+    output_write(first, digits + sizeof(digits) - first);
+}
+
+void output_flush(void) {
+    if(buffer == NULL)
+        return;
+
+    sink_write(buffer, buffer_size);
+    buffer_size = 0;
+}
+
+void output_close(void) {
+    output_flush();
+
+    free(buffer);
+    buffer = NULL;
+}
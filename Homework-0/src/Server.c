@@ -0,0 +1,428 @@
+#define _GNU_SOURCE                       // accept4, pipe2 and memrchr
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "../include/Server.h"
+#include "../include/Output.h"
+
+#define SERVER_MAX_EVENTS 64              // events handled per round of the event loop
+#define SERVER_READ_SIZE 65536            // bytes read from a client at once
+#define SERVER_MAX_LINE 768               // longest command line accepted (like the input of the stdin mode)
+#define SERVER_OUTPUT_LIMIT (1 << 20)     // a client's commands wait while this many bytes of its responses are unsent
+
+
+// ------------------------------ STRUCTS ------------------------------ //
+typedef struct connection* Connection;
+
+// A growable array of bytes
+typedef struct byte_buffer {
+    char*  data;
+    size_t size;                    // bytes in use
+    size_t capacity;                // bytes allocated
+} byte_buffer;
+
+typedef struct connection {
+    int         fd;
+    byte_buffer in;                 // bytes received, whose command lines are not yet executed
+    byte_buffer out;                // responses not yet sent
+    size_t      out_offset;         // bytes of out already sent
+    uint32_t    events;             // the events the connection is registered for
+    bool        discarding;         // whether the rest of an overlong line is being dropped
+    bool        done_sending;       // whether the client is done sending (the lines in in are the last ones)
+    bool        gone;               // whether the client is gone (the responses are dropped)
+    bool        closing;            // whether the connection closes once out is sent (the lines in in are dropped)
+    Connection  next;               // next connection of the server
+    Connection  back;               // previous connection of the server
+} connection;
+
+typedef struct server {
+    int           epoll_fd;
+    int           listen_fd;
+    int           signal_fd;        // read end of the pipe the signal handler writes to
+    Connection    connections;      // every open connection
+    ServerHandler handler;
+    Pointer       context;
+} server;
+
+
+// The write end of the pipe that wakes the event loop up, once a SIGINT or
+// SIGTERM arrives (whichever thread happens to receive it)
+static int signal_pipe = -1;
+
+static void server_signal_handler(int signal_number) {
+    (void)signal_number;
+    int saved_errno = errno;
+    if(write(signal_pipe, "", 1) < 0) {
+        // The pipe is full, so the event loop is going to wake up anyway
+    }
+    errno = saved_errno;
+}
+
+
+// ------------------------------ BYTE BUFFER ------------------------------ //
+
+// Makes room for at least extra more bytes in B
+static void buffer_reserve(byte_buffer* B, size_t extra) {
+    if(B->size + extra <= B->capacity)
+        return;
+
+    size_t capacity = (B->capacity == 0) ? SERVER_READ_SIZE : B->capacity;
+    while(capacity < B->size + extra)
+        capacity *= 2;
+
+    B->data = realloc(B->data, capacity);
+    if(B->data == NULL) {
+        fprintf(stderr, "Error: Memory reallocation failure | While reallocating memory for: buffer of connection.\n");
+        exit(EXIT_FAILURE);
+    }
+    B->capacity = capacity;
+}
+
+// Appends size bytes of data to B
+static void buffer_append(byte_buffer* B, const char* data, size_t size) {
+    buffer_reserve(B, size);
+    memcpy(B->data + B->size, data, size);
+    B->size += size;
+}
+
+// Frees B. If count_bytes is true, the space freed is added
+// into bytes_freed global variable as well
+static void buffer_destroy(byte_buffer* B, bool count_bytes) {
+    free(B->data);
+    if(count_bytes)
+        bytes_freed += B->capacity;
+}
+
+
+// ------------------------------ CONNECTION ------------------------------ //
+
+// The output sink of the commands of a connection: their responses are
+// gathered in its out buffer, and sent once the commands are executed
+static void connection_sink(const char* data, size_t size, Pointer context) {
+    Connection C = context;
+    buffer_append(&C->out, data, size);
+}
+
+// Accepts a new client of S, if any
+static void connection_accept(server* S) {
+    int fd = accept4(S->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if(fd < 0) {
+        if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            fprintf(stderr, "Warning: Could not accept a client of the server.\n");
+        return;
+    }
+
+    Connection C = calloc(1, sizeof(connection));
+    if(C == NULL) {
+        fprintf(stderr, "Error: Memory allocation failure | While allocating memory for: connection.\n");
+        exit(EXIT_FAILURE);
+    }
+    C->fd     = fd;
+    C->events = EPOLLIN;
+
+    struct epoll_event event = { .events = C->events, .data.ptr = C };
+    if(epoll_ctl(S->epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        fprintf(stderr, "Warning: Could not register a client of the server.\n");
+        close(fd);
+        free(C);
+        return;
+    }
+
+    // Link the connection at the head of the list of S
+    C->next = S->connections;
+    if(C->next != NULL)
+        C->next->back = C;
+    S->connections = C;
+}
+
+// Closes the connection C of S, and frees it. bytes_freed only counts what is
+// freed at exit, so count_bytes is true only once the server shuts down
+static void connection_close(server* S, Connection C, bool count_bytes) {
+    if(C->back != NULL)
+        C->back->next = C->next;
+    else
+        S->connections = C->next;
+    if(C->next != NULL)
+        C->next->back = C->back;
+
+    close(C->fd);           // which also takes it out of the epoll set
+    buffer_destroy(&C->in, count_bytes);
+    buffer_destroy(&C->out, count_bytes);
+    free(C);
+    if(count_bytes)
+        bytes_freed += sizeof(connection);
+}
+
+// Checks if the responses of C that are not yet sent have piled up
+static bool connection_backlogged(const Connection C) {
+    return C->out.size - C->out_offset >= SERVER_OUTPUT_LIMIT;
+}
+
+// Checks if C is done: either a command closed it, or its client is done
+// sending and every line it sent has been executed
+static bool connection_done(const Connection C) {
+    return C->closing || (C->done_sending && C->in.size == 0);
+}
+
+// Executes the complete command lines received by C, in order, gathering their
+// responses. It stops early once too many responses are waiting to be sent (the
+// rest of the lines are executed once they are), or once a command closes C.
+// A line longer than SERVER_MAX_LINE is not executed, but answered as malformed
+static void connection_serve(const server* S, const Connection C) {
+    if(C->in.size == 0)
+        return;
+
+    char* line = C->in.data;
+    char* end  = C->in.data + C->in.size;
+
+    while(!C->closing && !connection_backlogged(C)) {
+        char* new_line = memchr(line, '\n', end - line);
+        if(new_line == NULL)
+            break;
+
+        bool overlong = (size_t)(new_line - line) > SERVER_MAX_LINE;
+        *new_line = '\0';
+        if(new_line > line && new_line[-1] == '\r')
+            new_line[-1] = '\0';
+
+        output_set_sink(connection_sink, C);
+        if(C->discarding || overlong) {
+            output_printf("Malformed Input\n");
+            C->discarding = false;
+        }
+        else if(!S->handler(line, S->context))
+            C->closing = true;
+        output_printf("\n");
+        output_set_sink(NULL, NULL);
+
+        line = new_line + 1;
+    }
+
+    // Keep the incomplete line (and the lines not executed yet) for later. A line
+    // that can't fit in SERVER_MAX_LINE is dropped as it comes, and answered once over
+    size_t left = end - line;
+    if(left > SERVER_MAX_LINE && memchr(line, '\n', left) == NULL) {
+        C->discarding = true;
+        left = 0;
+    }
+    memmove(C->in.data, line, left);
+    C->in.size = left;
+}
+
+// Sends as much of the responses of C as the socket takes, and registers C for the
+// events it is waiting for. Closes C once it's done and its responses are sent (and
+// then returns false). Once the client is gone, the complete lines it sent are still
+// executed, but their responses are dropped
+static bool connection_flush(server* S, Connection C) {
+    while(C->out_offset < C->out.size && !C->gone) {
+        ssize_t sent = send(C->fd, C->out.data + C->out_offset, C->out.size - C->out_offset, MSG_NOSIGNAL);
+        if(sent < 0) {
+            if(errno == EINTR)
+                continue;
+            if(errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+
+            // Nothing more is read from the client, so a last incomplete line is dropped
+            const char* last_new_line = (C->in.size > 0) ? memrchr(C->in.data, '\n', C->in.size) : NULL;
+            C->in.size = (last_new_line != NULL) ? (size_t)(last_new_line - C->in.data) + 1 : 0;
+            C->gone = true;
+            C->done_sending = true;
+            break;
+        }
+        C->out_offset += sent;
+    }
+    if(C->out_offset == C->out.size || C->gone) {
+        C->out.size  = 0;
+        C->out_offset = 0;
+    }
+
+    bool pending = (C->out.size > 0);
+    if(connection_done(C) && !pending) {
+        connection_close(S, C, false);
+        return false;
+    }
+
+    // More commands are read only while the responses keep up
+    uint32_t events = 0;
+    if(!C->closing && !C->done_sending && !connection_backlogged(C))
+        events |= EPOLLIN;
+    if(pending)
+        events |= EPOLLOUT;
+
+    if(events != C->events) {
+        struct epoll_event event = { .events = events, .data.ptr = C };
+        epoll_ctl(S->epoll_fd, EPOLL_CTL_MOD, C->fd, &event);
+        C->events = events;
+    }
+    return true;
+}
+
+// Sends the responses of C, and goes on executing the command lines that waited
+// for them to be sent, for as long as the socket takes the responses at once
+static void connection_progress(server* S, Connection C) {
+    while(connection_flush(S, C)) {
+        if(C->closing || connection_backlogged(C) || C->in.size == 0
+           || memchr(C->in.data, '\n', C->in.size) == NULL)
+            return;
+        connection_serve(S, C);
+    }
+}
+
+// Reads what the client of C has sent, and executes the command lines in it
+static void connection_read(server* S, Connection C) {
+    if(C->done_sending) {
+        connection_progress(S, C);
+        return;
+    }
+
+    buffer_reserve(&C->in, SERVER_READ_SIZE);
+    ssize_t received = recv(C->fd, C->in.data + C->in.size, C->in.capacity - C->in.size, 0);
+    if(received < 0) {
+        if(errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)
+            return;
+        connection_close(S, C, false);
+        return;
+    }
+
+    // Once the client is done sending, a last line without a new line character
+    // is executed as well, and the connection closes once every line it sent is
+    // executed (which may wait for the responses of the earlier ones to be sent)
+    if(received == 0) {
+        C->done_sending = true;
+        if(C->discarding || (C->in.size > 0 && C->in.data[C->in.size - 1] != '\n'))
+            buffer_append(&C->in, "\n", 1);
+        connection_serve(S, C);
+    }
+    else {
+        C->in.size += received;
+        connection_serve(S, C);
+    }
+
+    connection_progress(S, C);
+}
+
+// Handles an event of the connection C
+static void connection_event(server* S, Connection C, uint32_t events) {
+    if(events & EPOLLOUT)
+        connection_progress(S, C);
+    else if(events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+        connection_read(S, C);
+}
+
+
+// ------------------------------ SERVER ------------------------------ //
+
+// Creates the listening socket at socket_path. A socket left behind by a previous
+// run is removed first (any other file at socket_path is left alone)
+static int server_listen(const char* socket_path) {
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    if(strlen(socket_path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Error: The socket path %s is too long.\n", socket_path);
+        return -1;
+    }
+    strcpy(address.sun_path, socket_path);
+
+    struct stat file_stat;
+    if(stat(socket_path, &file_stat) == 0 && S_ISSOCK(file_stat.st_mode))
+        unlink(socket_path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(fd < 0) {
+        fprintf(stderr, "Error occurred while creating the socket %s.\n", socket_path);
+        return -1;
+    }
+    if(bind(fd, (struct sockaddr*) &address, sizeof(address)) < 0 || listen(fd, SOMAXCONN) < 0) {
+        fprintf(stderr, "Error occurred while listening on the socket %s.\n", socket_path);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Registers fd with S for input, tagged with tag
+static bool server_watch(const server* S, int fd, Pointer tag) {
+    struct epoll_event event = { .events = EPOLLIN, .data.ptr = tag };
+    return epoll_ctl(S->epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0;
+}
+
+bool server_run(const char* socket_path, ServerHandler handler, Pointer context) {
+    assert(socket_path != NULL);
+    assert(handler != NULL);
+
+    server S = { .epoll_fd = -1, .listen_fd = -1, .signal_fd = -1, .connections = NULL,
+                 .handler = handler, .context = context };
+
+    int pipe_fds[2];
+    S.listen_fd = server_listen(socket_path);
+    if(S.listen_fd < 0)
+        return false;
+
+    S.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if(S.epoll_fd < 0 || pipe2(pipe_fds, O_NONBLOCK | O_CLOEXEC) < 0) {
+        fprintf(stderr, "Error occurred while setting up the server.\n");
+        if(S.epoll_fd >= 0)
+            close(S.epoll_fd);
+        close(S.listen_fd);
+        unlink(socket_path);
+        return false;
+    }
+    S.signal_fd = pipe_fds[0];
+    signal_pipe = pipe_fds[1];
+
+    struct sigaction action = { 0 }, old_int, old_term;
+    action.sa_handler = server_signal_handler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGINT, &action, &old_int);
+    sigaction(SIGTERM, &action, &old_term);
+
+    server_watch(&S, S.listen_fd, &S.listen_fd);
+    server_watch(&S, S.signal_fd, &S.signal_fd);
+
+    bool running = true;
+    struct epoll_event events[SERVER_MAX_EVENTS];
+    while(running) {
+        int n_events = epoll_wait(S.epoll_fd, events, SERVER_MAX_EVENTS, -1);
+        if(n_events < 0) {
+            if(errno == EINTR)
+                continue;
+            fprintf(stderr, "Error occurred while waiting for the clients of the server.\n");
+            break;
+        }
+
+        for(int i = 0; i < n_events; i++) {
+            Pointer tag = events[i].data.ptr;
+            if(tag == &S.signal_fd)
+                running = false;
+            else if(tag == &S.listen_fd)
+                connection_accept(&S);
+            else
+                connection_event(&S, tag, events[i].events);
+        }
+    }
+
+    // Shut down: the clients are dropped, along with their pending responses
+    while(S.connections != NULL)
+        connection_close(&S, S.connections, true);
+
+    sigaction(SIGINT, &old_int, NULL);
+    sigaction(SIGTERM, &old_term, NULL);
+    close(pipe_fds[1]);
+    close(pipe_fds[0]);
+    signal_pipe = -1;
+
+    close(S.epoll_fd);
+    close(S.listen_fd);
+    unlink(socket_path);
+    return true;
+}
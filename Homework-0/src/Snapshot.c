@@ -0,0 +1,60 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../include/Snapshot.h"
+
+
+// ------------------------------ SNAPSHOT ------------------------------ //
+bool snapshot_write(FILE* file, const void* data, size_t size) {
+    return size == 0 || fwrite(data, 1, size, file) == size;
+}
+
+bool snapshot_align(FILE* file) {
+    static const char zeros[SNAPSHOT_ALIGNMENT] = { 0 };
+
+    long position = ftell(file);
+    if(position < 0)
+        return false;
+
+    size_t remainder = (size_t)position % SNAPSHOT_ALIGNMENT;
+    return remainder == 0 || snapshot_write(file, zeros, SNAPSHOT_ALIGNMENT - remainder);
+}
+
+bool snapshot_is_valid(const char* data, size_t size) {
+    if(size < sizeof(snapshot_header))
+        return false;
+
+    const snapshot_header* header = (const snapshot_header*) data;
+    return memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) == 0
+        && header->byte_order == SNAPSHOT_BYTE_ORDER
+        && header->version    == SNAPSHOT_VERSION
+        && header->file_size  == size
+        && header->voters_offset >= sizeof(snapshot_header)
+        && header->voters_offset <= header->table_offset
+        && header->table_offset  <= header->index_offset
+        && header->index_offset  <= header->file_size
+        && header->voters_offset % SNAPSHOT_ALIGNMENT == 0
+        && header->table_offset  % SNAPSHOT_ALIGNMENT == 0
+        && header->index_offset  % SNAPSHOT_ALIGNMENT == 0;
+}
+
+// The time and the process are mixed (as in splitmix64), so that two
+// snapshots saved at once by different processes get different ids too
+uint64_t snapshot_new_id(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    uint64_t id = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+    id ^= (uint64_t)getpid() << 40;
+    id = (id ^ (id >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    id = (id ^ (id >> 27)) * 0x94D049BB133111EBULL;
+    id ^= id >> 31;
+    return (id != 0) ? id : 1;
+}
+
+// Divides instead of multiplying, so that no count read from a file can overflow
+bool snapshot_fits(size_t size, uint64_t offset, uint64_t count, size_t item_size) {
+    return offset <= size && count <= (size - offset) / item_size;
+}
@@ -0,0 +1,334 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <pthread.h>
+#include "../include/Global.h"
+#include "../include/StringPool.h"
+#include "../include/Snapshot.h"
+
+#define STRING_CHUNK_SIZE       (64 * 1024)     // bytes per string chunk
+#define STRING_POOL_SEGMENT_BITS 10             // the first segment of the directory holds 2^10 strings
+#define STRING_POOL_N_SEGMENTS  (32 - STRING_POOL_SEGMENT_BITS + 1)     // enough segments for any id
+#define STRING_POOL_INITIAL_SLOTS 1024          // initial slots of the map (a power of 2)
+#define STRING_POOL_BATCH_SIZE  256             // strings interned per lock by string_pool_intern_batch
+
+
+// ------------------------------ STRUCTS ------------------------------ //
+
+// A chunk of the bump-allocated string region. Strings are copied
+// back to back into data, and never freed one by one
+typedef struct string_chunk* StringChunk;
+
+typedef struct string_chunk {
+    size_t      capacity;                  // bytes available in data
+    size_t      used;                      // bytes handed out so far
+    StringChunk next;                      // previously filled chunk
+    char        data[];                    // the strings themselves
+} string_chunk;
+
+
+// The strings are found by id through a segmented directory (laid out as the
+// one of the HashTable), whose segments never move, so that string_pool_get
+// needs no lock. They are found by content through an open addressing map,
+// with linear probing, whose slots hold the hash of a string along with its id.
+// The number of strings is read without the lock as well, hence it is only
+// ever changed atomically.
+typedef struct string_pool {
+    const char** segments[STRING_POOL_N_SEGMENTS];  // the directory of strings, by id
+    uint64_t*   slots;                     // hash << 32 | (id + 1), or 0 for an empty slot
+    size_t      n_slots;                   // number of slots of the map (a power of 2)
+    size_t      n_strings;                 // number of strings interned (read atomically)
+    size_t      bytes;                     // total length of the strings (terminating characters included)
+    size_t      segment_bytes;             // bytes of the segments allocated
+    StringChunk chunks;                    // current string chunk (head of the chunk list)
+    pthread_rwlock_t lock;                 // shared to look a string up, exclusive to add one
+} string_pool;
+
+
+// ------------------------------ STRING POOL UTILS ------------------------------ //
+
+// The 32-bit FNV-1a hash of the length first characters of string
+static uint32_t string_hash(const char* string, size_t length) {
+    uint32_t hash = 2166136261u;
+    for(size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)string[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Returns the segment that the string with the given id belongs to
+static int segment_of(uint32_t id) {
+    if(id < ((uint32_t)1 << STRING_POOL_SEGMENT_BITS))
+        return 0;
+    return (31 - __builtin_clz(id)) - STRING_POOL_SEGMENT_BITS + 1;
+}
+
+// Returns the number of strings segment k holds
+static size_t segment_capacity(int k) {
+    return (size_t)1 << ((k == 0) ? STRING_POOL_SEGMENT_BITS : STRING_POOL_SEGMENT_BITS + k - 1);
+}
+
+// Returns the slot of the directory of the string with the given id (its segment must exist)
+static const char** string_pool_slot(const StringPool P, uint32_t id) {
+    int k = segment_of(id);
+    size_t first = (k == 0) ? 0 : segment_capacity(k);      // segment k > 0 starts at its own capacity
+    return &P->segments[k][id - first];
+}
+
+// Allocates a new string chunk able to hold at least min_size bytes
+static StringChunk string_chunk_create(size_t min_size, StringChunk next) {
+    size_t capacity = (min_size > STRING_CHUNK_SIZE) ? min_size : STRING_CHUNK_SIZE;
+
+    StringChunk C = malloc(sizeof(string_chunk) + capacity);
+    if(C == NULL) {
+        fprintf(stderr, "Error: Memory allocation failure | While allocating memory for: string_chunk.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    C->capacity = capacity;
+    C->used     = 0;
+    C->next     = next;
+
+    return C;
+}
+
+// Returns the id of the length first characters of string (whose hash is hash),
+// or UINT32_MAX if they are not in P
+static uint32_t string_pool_find(const StringPool P, const char* string, size_t length, uint32_t hash) {
+    size_t mask = P->n_slots - 1;
+    for(size_t i = hash & mask; P->slots[i] != 0; i = (i + 1) & mask) {
+        if((uint32_t)(P->slots[i] >> 32) != hash)
+            continue;
+
+        uint32_t id = (uint32_t)P->slots[i] - 1;
+        const char* candidate = *string_pool_slot(P, id);
+        if(strncmp(candidate, string, length) == 0 && candidate[length] == '\0')
+            return id;
+    }
+    return UINT32_MAX;
+}
+
+// Puts the entry of a string (its hash and id, as a slot) into the map of P
+static void string_pool_map_put(const StringPool P, uint64_t entry) {
+    size_t mask = P->n_slots - 1;
+    size_t i = (entry >> 32) & mask;
+    while(P->slots[i] != 0)
+        i = (i + 1) & mask;
+    P->slots[i] = entry;
+}
+
+// Doubles the slots of the map of P. The hashes are kept in the slots,
+// so no string is read again. The old slots are not counted into bytes_freed,
+// which only counts what is freed at exit
+static void string_pool_map_grow(const StringPool P) {
+    uint64_t* old_slots = P->slots;
+    size_t old_n_slots  = P->n_slots;
+
+    P->n_slots *= 2;
+    P->slots = calloc(P->n_slots, sizeof(uint64_t));
+    if(P->slots == NULL) {
+        fprintf(stderr, "Error: Memory allocation failure | While allocating memory for: slots of string_pool.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for(size_t i = 0; i < old_n_slots; i++) {
+        if(old_slots[i] != 0)
+            string_pool_map_put(P, old_slots[i]);
+    }
+
+    free(old_slots);
+}
+
+// Copies the length first characters of string (whose hash is hash) into P, and
+// returns their new id. The map is kept at most half full
+static uint32_t string_pool_add(const StringPool P, const char* string, size_t length, uint32_t hash) {
+    assert(P->n_strings < UINT32_MAX);
+
+    uint32_t id = P->n_strings;
+    int k = segment_of(id);
+    if(P->segments[k] == NULL) {
+        P->segments[k] = malloc(sizeof(const char*) * segment_capacity(k));
+        if(P->segments[k] == NULL) {
+            fprintf(stderr, "Error: Memory allocation failure | While allocating memory for: segment of string_pool.\n");
+            exit(EXIT_FAILURE);
+        }
+        P->segment_bytes += sizeof(const char*) * segment_capacity(k);
+    }
+
+    if(P->chunks == NULL || P->chunks->capacity - P->chunks->used < length + 1)
+        P->chunks = string_chunk_create(length + 1, P->chunks);
+
+    char* copy = P->chunks->data + P->chunks->used;
+    memcpy(copy, string, length);
+    copy[length] = '\0';
+    P->chunks->used += length + 1;
+
+    *string_pool_slot(P, id) = copy;
+    __atomic_store_n(&P->n_strings, P->n_strings + 1, __ATOMIC_RELEASE);
+    P->bytes += length + 1;
+
+    if(2 * P->n_strings > P->n_slots)
+        string_pool_map_grow(P);
+    string_pool_map_put(P, ((uint64_t)hash << 32) | (id + 1));
+
+    return id;
+}
+
+
+// ------------------------------ STRING POOL ------------------------------ //
+
+StringPool string_pool_create(void) {
+    StringPool P = malloc(sizeof(string_pool));
+    if(P == NULL) {
+        fprintf(stderr, "Error: Memory allocation failure | While allocating memory for: string_pool.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    P->n_slots = STRING_POOL_INITIAL_SLOTS;
+    P->slots   = calloc(P->n_slots, sizeof(uint64_t));
+    if(P->slots == NULL) {
+        fprintf(stderr, "Error: Memory allocation failure | While allocating memory for: slots of string_pool.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for(int k = 0; k < STRING_POOL_N_SEGMENTS; k++)
+        P->segments[k] = NULL;
+
+    P->n_strings     = 0;
+    P->bytes         = 0;
+    P->segment_bytes = 0;
+    P->chunks        = NULL;
+    pthread_rwlock_init(&P->lock, NULL);
+
+    return P;
+}
+
+// Most strings interned are already in the pool, so they are first looked up
+// with the lock shared. A string that is missing is looked up once more with
+// the lock held exclusively, as another thread may have added it in between
+uint32_t string_pool_intern(const StringPool P, const char* string, size_t length) {
+    assert(P != NULL);
+    assert(string != NULL);
+
+    uint32_t hash = string_hash(string, length);
+
+    pthread_rwlock_rdlock(&P->lock);
+    uint32_t id = string_pool_find(P, string, length, hash);
+    pthread_rwlock_unlock(&P->lock);
+    if(id != UINT32_MAX)
+        return id;
+
+    pthread_rwlock_wrlock(&P->lock);
+    id = string_pool_find(P, string, length, hash);
+    if(id == UINT32_MAX)
+        id = string_pool_add(P, string, length, hash);
+    pthread_rwlock_unlock(&P->lock);
+
+    return id;
+}
+
+void string_pool_intern_batch(const StringPool P, const char* const* strings, const size_t* lengths,
+                              size_t n, uint32_t* ids) {
+    assert(P != NULL);
+    assert(n == 0 || (strings != NULL && lengths != NULL && ids != NULL));
+
+    uint32_t hashes[STRING_POOL_BATCH_SIZE];
+    for(size_t first = 0; first < n; first += STRING_POOL_BATCH_SIZE) {
+        size_t count = (n - first < STRING_POOL_BATCH_SIZE) ? n - first : STRING_POOL_BATCH_SIZE;
+        const char* const* batch = strings + first;
+
+        for(size_t i = 0; i < count; i++)
+            hashes[i] = string_hash(batch[i], lengths[first + i]);
+
+        bool missing = false;
+        pthread_rwlock_rdlock(&P->lock);
+        for(size_t i = 0; i < count; i++) {
+            ids[first + i] = string_pool_find(P, batch[i], lengths[first + i], hashes[i]);
+            missing |= (ids[first + i] == UINT32_MAX);
+        }
+        pthread_rwlock_unlock(&P->lock);
+        if(!missing)
+            continue;
+
+        // The same string may be missing more than once in the batch, so
+        // every string that was missing is looked up again before it's added
+        pthread_rwlock_wrlock(&P->lock);
+        for(size_t i = 0; i < count; i++) {
+            if(ids[first + i] != UINT32_MAX)
+                continue;
+            ids[first + i] = string_pool_find(P, batch[i], lengths[first + i], hashes[i]);
+            if(ids[first + i] == UINT32_MAX)
+                ids[first + i] = string_pool_add(P, batch[i], lengths[first + i], hashes[i]);
+        }
+        pthread_rwlock_unlock(&P->lock);
+    }
+}
+
+const char* string_pool_get(const StringPool P, uint32_t id) {
+    assert(P != NULL);
+    assert(id < __atomic_load_n(&P->n_strings, __ATOMIC_ACQUIRE));
+
+    return *string_pool_slot(P, id);
+}
+
+size_t string_pool_size(const StringPool P) {
+    assert(P != NULL);
+
+    return __atomic_load_n(&P->n_strings, __ATOMIC_ACQUIRE);
+}
+
+size_t string_pool_bytes(const StringPool P) {
+    assert(P != NULL);
+
+    return P->bytes;
+}
+
+bool string_pool_save(const StringPool P, FILE* file) {
+    assert(P != NULL);
+
+    for(size_t id = 0; id < P->n_strings; id++) {
+        const char* string = *string_pool_slot(P, id);
+        if(!snapshot_write(file, string, strlen(string) + 1))
+            return false;
+    }
+    return true;
+}
+
+void string_pool_load(const StringPool P, const char* strings, size_t n, uint32_t* ids) {
+    assert(P != NULL);
+
+    for(size_t i = 0; i < n; i++) {
+        size_t length = strlen(strings);
+        ids[i] = string_pool_intern(P, strings, length);
+        strings += length + 1;
+    }
+}
+
+// Frees the map, the segments and the string chunks of P, and adds
+// the space freed into bytes_freed global variable
+void string_pool_destroy(StringPool P) {
+    if(P == NULL)
+        return;
+
+    free(P->slots);
+    bytes_freed += sizeof(uint64_t) * P->n_slots;
+
+    for(int k = 0; k < STRING_POOL_N_SEGMENTS && P->segments[k] != NULL; k++)
+        free(P->segments[k]);
+    bytes_freed += P->segment_bytes;
+
+    StringChunk temp = P->chunks;
+    while(temp != NULL) {
+        StringChunk next = temp->next;
+        bytes_freed += sizeof(string_chunk) + temp->capacity;
+        free(temp);
+        temp = next;
+    }
+
+    pthread_rwlock_destroy(&P->lock);
+    free(P);
+    bytes_freed += sizeof(string_pool);
+}
@@ -2,57 +2,391 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
 #include "../include/Voter.h"
+#include "../include/StringPool.h"
+#include "../include/Snapshot.h"
+#include "../include/Output.h"
 
+#define VOTER_SEGMENT_BITS  12              // the first segment of the store holds 2^12 voters
+#define VOTER_N_SEGMENTS    (32 - VOTER_SEGMENT_BITS + 1)       // enough segments for any index
+#define VOTER_BATCH_SIZE    128             // voters whose names voter_create_batch_at interns at once
 
-// ------------------------------ VOTER ------------------------------ //
+
+// ------------------------------ STRUCTS ------------------------------ //
+
+// The names of a voter are ids within the pool of names (see below),
+// so voters with the same name or surname share a single copy of it
 typedef struct voter {
     int pin;
-    char* name;
-    char* surname;
+    uint32_t name;                         // id of the name within the names pool
+    uint32_t surname;                      // id of the surname within the names pool
     int postal_code;
+    unsigned int index;                    // index of the voter within its store
+    unsigned int zip_slot;                 // position of the voter within its zipcode (once voted)
     char has_voted;
 } voter; 
 
 
-Voter voter_create(int pin, const char* name, const char* surname, int postal_code) {
-    Voter V = malloc(sizeof(voter));
-    assert(V != NULL);
+// The voters live in segments laid out as the directory of the HashTable: segment 0
+// holds the first 2^VOTER_SEGMENT_BITS voters, and every segment k > 0 as many voters
+// as all the segments before it together. Segments never move, so the voter with a
+// given index is found without any lock, and the table and the index refer to the
+// voters by their 32-bit index alone.
+typedef struct voter_store {
+    voter*      segments[VOTER_N_SEGMENTS];     // the segments of voters (NULL until needed)
+    size_t      n_voters;                  // number of voters handed out
+    unsigned int* free_slots;              // indices of the slots of deleted voters, to be reused
+    size_t      n_free;                    // number of free slots
+    size_t      free_capacity;             // capacity of the free_slots array
+    pthread_mutex_t lock;                  // serializes the voters created by several threads at once
+} voter_store;
+
+
+// The names of the voters of every store are interned into a single pool, so that
+// a voter can be printed without its store. The pool is created along with the
+// first store, and destroyed along with the last one
+static StringPool names = NULL;
+static size_t n_stores = 0;
+static pthread_mutex_t names_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+// ------------------------------ VOTER STORE ------------------------------ //
+
+// Returns the segment that the voter at index belongs to
+static int segment_of(size_t index) {
+    if(index < ((size_t)1 << VOTER_SEGMENT_BITS))
+        return 0;
+    return (63 - __builtin_clzll(index)) - VOTER_SEGMENT_BITS + 1;
+}
+
+// Returns the number of voters segment k holds
+static size_t segment_capacity(int k) {
+    return (size_t)1 << ((k == 0) ? VOTER_SEGMENT_BITS : VOTER_SEGMENT_BITS + k - 1);
+}
+
+// Makes sure that S has segments for at least n_voters voters
+static void voter_store_grow(const VoterStore S, size_t n_voters) {
+    assert(S != NULL);
+    assert(n_voters <= VOTER_NO_INDEX);
+
+    if(n_voters == 0)
+        return;
 
-    V->pin = pin;
-    int name_len = strlen(name);
-    int surname_len = strlen(surname);
+    for(int k = 0; k <= segment_of(n_voters - 1); k++) {
+        if(S->segments[k] != NULL)
+            continue;
 
-    V->name = malloc(sizeof(char) * (name_len + 1));
-    if(V->name == NULL) {
-        fprintf(stderr, "Error: Memory allocation failure | While allocating memory for: V->name.\n");
+        S->segments[k] = malloc(sizeof(voter) * segment_capacity(k));
+        if(S->segments[k] == NULL) {
+            fprintf(stderr, "Error: Memory allocation failure | While allocating memory for: segment of voter_store.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+// Returns the voter slot with the given index
+static Voter voter_store_slot(const VoterStore S, size_t index) {
+    int k = segment_of(index);
+    size_t first = (k == 0) ? 0 : segment_capacity(k);      // segment k > 0 starts at its own capacity
+    return &S->segments[k][index - first];
+}
+
+// Hands out the next n_voters slots of S, and returns the index of the first one.
+// The number of voters is read without the lock by voter_store_get, hence the
+// atomic store
+static size_t voter_store_take(const VoterStore S, size_t n_voters) {
+    size_t first = S->n_voters;
+    voter_store_grow(S, first + n_voters);
+    __atomic_store_n(&S->n_voters, first + n_voters, __ATOMIC_RELEASE);
+    return first;
+}
+
+// Adds the slot with the given index to the free slots of S
+static void voter_store_release(const VoterStore S, size_t index) {
+    if(S->n_free == S->free_capacity) {
+        S->free_capacity = (S->free_capacity == 0) ? 64 : S->free_capacity * 2;
+        S->free_slots = realloc(S->free_slots, sizeof(unsigned int) * S->free_capacity);
+        if(S->free_slots == NULL) {
+            fprintf(stderr, "Error: Memory reallocation failure | While reallocating memory for: free slots of voter_store.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    S->free_slots[S->n_free++] = index;
+}
+
+// Fills the voter slot V (the one with the given index), with the
+// ids of the names, as interned into the names pool
+static void voter_init(Voter V, size_t index, int pin, uint32_t name, uint32_t surname, int postal_code) {
+    V->pin         = pin;
+    V->index       = index;
+    V->name        = name;
+    V->surname     = surname;
+    V->postal_code = postal_code;
+    V->has_voted   = 'N';
+}
+
+VoterStore voter_store_create(void) {
+    VoterStore S = malloc(sizeof(voter_store));
+    if(S == NULL) {
+        fprintf(stderr, "Error: Memory allocation failure | While allocating memory for: voter_store.\n");
         exit(EXIT_FAILURE);
     }
-    strcpy(V->name, name);
 
-    V->surname = malloc(sizeof(char) * (surname_len + 1));
-    if(V->surname == NULL) {
-        fprintf(stderr, "Error: Memory allocation failure | While allocating memory for: V->surname.\n");
+    for(int k = 0; k < VOTER_N_SEGMENTS; k++)
+        S->segments[k] = NULL;
+    S->n_voters       = 0;
+    S->free_slots     = NULL;
+    S->n_free         = 0;
+    S->free_capacity  = 0;
+    pthread_mutex_init(&S->lock, NULL);
+
+    pthread_mutex_lock(&names_lock);
+    if(n_stores++ == 0)
+        names = string_pool_create();
+    pthread_mutex_unlock(&names_lock);
+
+    return S;
+}
+
+size_t voter_store_n_voters(const VoterStore S) {
+    assert(S != NULL);
+
+    return S->n_voters;
+}
+
+size_t voter_store_reserve(const VoterStore S, size_t n_voters) {
+    assert(S != NULL);
+
+    return voter_store_take(S, n_voters);
+}
+
+Voter voter_store_get(const VoterStore S, size_t index) {
+    assert(S != NULL);
+    assert(index < __atomic_load_n(&S->n_voters, __ATOMIC_ACQUIRE));
+
+    return voter_store_slot(S, index);
+}
+
+// Writes the voters section of a snapshot: the voters in order of index,
+// followed by the strings of the names pool, and then by the indices of
+// the free slots
+bool voter_store_save(const VoterStore S, FILE* file) {
+    assert(S != NULL);
+
+    snapshot_store_header header = { 0 };
+    header.n_voters     = S->n_voters;
+    header.n_strings    = string_pool_size(names);
+    header.string_bytes = string_pool_bytes(names);
+    header.n_free       = S->n_free;
+    header.free_offset  = sizeof(header) + sizeof(snapshot_voter) * S->n_voters + header.string_bytes;
+    header.free_offset  = (header.free_offset + SNAPSHOT_ALIGNMENT - 1) & ~(uint64_t)(SNAPSHOT_ALIGNMENT - 1);
+    if(!snapshot_write(file, &header, sizeof(header)))
+        return false;
+
+    for(size_t i = 0; i < S->n_voters; i++) {
+        Voter V = voter_store_slot(S, i);
+        snapshot_voter record = { 0 };
+        record.name        = V->name;
+        record.surname     = V->surname;
+        record.pin         = V->pin;
+        record.postal_code = V->postal_code;
+        record.has_voted   = voter_has_voted(V);
+        if(!snapshot_write(file, &record, sizeof(record)))
+            return false;
+    }
+
+    if(!string_pool_save(names, file) || !snapshot_align(file))
+        return false;
+
+    for(size_t i = 0; i < S->n_free; i++) {
+        uint32_t index = S->free_slots[i];
+        if(!snapshot_write(file, &index, sizeof(index)))
+            return false;
+    }
+    return snapshot_align(file);
+}
+
+// Checks if the bytes bytes starting at strings hold exactly n null terminated strings
+static bool strings_are_valid(const char* strings, size_t bytes, uint64_t n) {
+    const char* end = strings + bytes;
+    for(uint64_t i = 0; i < n; i++) {
+        const char* terminator = memchr(strings, '\0', end - strings);
+        if(terminator == NULL)
+            return false;
+        strings = terminator + 1;
+    }
+    return strings == end;
+}
+
+// Loads the voters section of a snapshot into the empty store S. The strings
+// are interned first, and the ids of the names of the voters are then mapped
+// to the ids the strings got (the same ones, unless the pool was not empty).
+// The section is checked as a whole before anything is loaded out of it
+bool voter_store_load(const VoterStore S, const char* section, size_t size) {
+    assert(S != NULL);
+    assert(S->n_voters == 0);
+
+    if(!snapshot_fits(size, 0, 1, sizeof(snapshot_store_header)))
+        return false;
+    const snapshot_store_header* header = (const snapshot_store_header*) section;
+    const snapshot_voter* records = (const snapshot_voter*)(header + 1);
+
+    size_t offset = sizeof(*header);
+    if(header->n_voters >= VOTER_NO_INDEX || !snapshot_fits(size, offset, header->n_voters, sizeof(snapshot_voter)))
+        return false;
+    offset += sizeof(snapshot_voter) * header->n_voters;
+    const char* strings_section = section + offset;
+    if(header->n_strings >= UINT32_MAX || !snapshot_fits(size, offset, header->string_bytes, 1)
+        || !strings_are_valid(strings_section, header->string_bytes, header->n_strings))
+        return false;
+    offset += header->string_bytes;
+    if(header->free_offset < offset || header->free_offset % sizeof(uint32_t) != 0
+        || !snapshot_fits(size, header->free_offset, header->n_free, sizeof(uint32_t)))
+        return false;
+
+    const uint32_t* free_slots = (const uint32_t*)(section + header->free_offset);
+    for(size_t i = 0; i < header->n_voters; i++) {
+        if(records[i].name >= header->n_strings || records[i].surname >= header->n_strings)
+            return false;
+    }
+    for(size_t i = 0; i < header->n_free; i++) {
+        if(free_slots[i] >= header->n_voters)
+            return false;
+    }
+
+    if(header->n_voters == 0)
+        return true;
+
+    uint32_t* ids = malloc(sizeof(uint32_t) * header->n_strings);
+    if(ids == NULL) {
+        fprintf(stderr, "Error: Memory allocation failure | While allocating memory for: string ids.\n");
         exit(EXIT_FAILURE);
     }
-    strcpy(V->surname, surname);
+    string_pool_load(names, strings_section, header->n_strings, ids);
 
-    V->postal_code = postal_code;
-    V->has_voted = 'N';
+    voter_store_reserve(S, header->n_voters);
+    for(size_t i = 0; i < header->n_voters; i++) {
+        Voter V = voter_store_slot(S, i);
+        voter_init(V, i, records[i].pin, ids[records[i].name], ids[records[i].surname], records[i].postal_code);
+        V->has_voted = records[i].has_voted ? 'Y' : 'N';
+    }
+    free(ids);
+
+    for(size_t i = 0; i < header->n_free; i++)
+        voter_store_release(S, free_slots[i]);
+
+    return true;
+}
+
+// Frees all the segments of S at once (and the names pool, along with the last
+// store), and adds the space freed into bytes_freed global variable
+void voter_store_destroy(VoterStore S) {
+    if(S == NULL)
+        return;
+
+    for(int k = 0; k < VOTER_N_SEGMENTS && S->segments[k] != NULL; k++) {
+        free(S->segments[k]);
+        bytes_freed += sizeof(voter) * segment_capacity(k);
+    }
+
+    free(S->free_slots);
+    bytes_freed += sizeof(unsigned int) * S->free_capacity;
+
+    pthread_mutex_lock(&names_lock);
+    if(--n_stores == 0) {
+        string_pool_destroy(names);
+        names = NULL;
+    }
+    pthread_mutex_unlock(&names_lock);
+
+    pthread_mutex_destroy(&S->lock);
+    free(S);
+    bytes_freed += sizeof(voter_store);
+}
+
+
+// ------------------------------ VOTER ------------------------------ //
+Voter voter_create(const VoterStore S, int pin, const char* name, const char* surname, int postal_code) {
+    assert(name != NULL && surname != NULL);
+
+    return voter_create_n(S, pin, name, strlen(name), surname, strlen(surname), postal_code);
+}
+
+Voter voter_create_n(const VoterStore S, int pin, const char* name, size_t name_len,
+                     const char* surname, size_t surname_len, int postal_code) {
+    assert(S != NULL);
+    assert(name != NULL && surname != NULL);
+
+    // The pool has a lock of its own, so the names are interned before
+    // the store is locked
+    uint32_t name_id    = string_pool_intern(names, name, name_len);
+    uint32_t surname_id = string_pool_intern(names, surname, surname_len);
+
+    pthread_mutex_lock(&S->lock);
+
+    // The slot of a deleted voter is reused first
+    size_t index;
+    if(S->n_free > 0)
+        index = S->free_slots[--S->n_free];
+    else
+        index = voter_store_take(S, 1);
+
+    Voter V = voter_store_slot(S, index);
+    voter_init(V, index, pin, name_id, surname_id, postal_code);
+
+    pthread_mutex_unlock(&S->lock);
 
     return V;
 }
 
+void voter_create_batch_at(const VoterStore S, size_t index, const VoterFields* fields, size_t n) {
+    assert(S != NULL);
+    assert(index + n <= __atomic_load_n(&S->n_voters, __ATOMIC_ACQUIRE));
+
+    // The names and surnames of the voters are interned together, as one batch
+    const char* strings[2 * VOTER_BATCH_SIZE];
+    size_t lengths[2 * VOTER_BATCH_SIZE];
+    uint32_t ids[2 * VOTER_BATCH_SIZE];
+
+    for(size_t first = 0; first < n; first += VOTER_BATCH_SIZE) {
+        size_t count = (n - first < VOTER_BATCH_SIZE) ? n - first : VOTER_BATCH_SIZE;
+        for(size_t i = 0; i < count; i++) {
+            strings[2 * i]     = fields[first + i].name;
+            lengths[2 * i]     = fields[first + i].name_len;
+            strings[2 * i + 1] = fields[first + i].surname;
+            lengths[2 * i + 1] = fields[first + i].surname_len;
+        }
+        string_pool_intern_batch(names, strings, lengths, 2 * count, ids);
+
+        for(size_t i = 0; i < count; i++) {
+            const VoterFields* F = &fields[first + i];
+            voter_init(voter_store_slot(S, index + first + i), index + first + i, F->pin,
+                       ids[2 * i], ids[2 * i + 1], F->postal_code);
+        }
+    }
+}
+
+void voter_destroy(const VoterStore S, const Voter V) {
+    assert(S != NULL && V != NULL);
+
+    pthread_mutex_lock(&S->lock);
+    voter_store_release(S, V->index);
+    pthread_mutex_unlock(&S->lock);
+}
+
+// has_voted is the only field of a voter that changes once it's created, so
+// it is read and written atomically, for the readers of a shared DataBase
 bool voter_has_voted(const Voter V) {
     assert(V != NULL);
 
-    return (V->has_voted == 'Y');
+    return (__atomic_load_n(&V->has_voted, __ATOMIC_RELAXED) == 'Y');
 }
 
-void voter_vote(const Voter V) {
+bool voter_vote(const Voter V) {
     assert(V != NULL);
 
-    V->has_voted = 'Y';
+    return (__atomic_exchange_n(&V->has_voted, 'Y', __ATOMIC_RELAXED) != 'Y');
 }
 
 int voter_get_pin(const Voter V) {
@@ -61,6 +395,36 @@ int voter_get_pin(const Voter V) {
     return V->pin;
 }
 
+const char* voter_get_name(const Voter V) {
+    assert(V != NULL);
+
+    return string_pool_get(names, V->name);
+}
+
+const char* voter_get_surname(const Voter V) {
+    assert(V != NULL);
+
+    return string_pool_get(names, V->surname);
+}
+
+unsigned int voter_get_index(const Voter V) {
+    assert(V != NULL);
+
+    return V->index;
+}
+
+unsigned int voter_get_zip_slot(const Voter V) {
+    assert(V != NULL);
+
+    return V->zip_slot;
+}
+
+void voter_set_zip_slot(const Voter V, unsigned int slot) {
+    assert(V != NULL);
+
+    V->zip_slot = slot;
+}
+
 int voter_get_zip(const Voter V) {
     assert(V != NULL);
 
@@ -69,38 +433,23 @@ int voter_get_zip(const Voter V) {
 
 void voter_print(const Pointer P) {
     if(P == NULL) {
-        printf("{ -- empty slot -- }\n");
+        output_printf("{ -- empty slot -- }\n");
         return;
     }
 
     Voter v = (Voter) P;
-    printf("%d %s %s %d %c\n", v->pin, v->surname, v->name, v->postal_code, v->has_voted);
+    output_printf("%d %s %s %d %c\n", v->pin, string_pool_get(names, v->surname), string_pool_get(names, v->name),
+                  v->postal_code, voter_has_voted(v) ? 'Y' : 'N');
 }
 
 void voter_print_pin(const Pointer P) {
     if(P == NULL) {
-        printf("{ -- empty slot -- }\n");
+        output_printf("{ -- empty slot -- }\n");
         return;
     }
 
     Voter v = (Voter) P;
-    printf("\t%d\n", v->pin);
-}
-
-void voter_destroy(const Pointer P) {
-    if(P == NULL)
-        return;
-    
-    Voter v = (Voter) P;
-    int name_len = strlen(v->name);
-    int surname_len = strlen(v->surname);
-
-    free(v->name);
-    bytes_freed += sizeof(char) * (name_len + 1);
-
-    free(v->surname);
-    bytes_freed += sizeof(char) * (surname_len + 1);
-
-    free(v); 
-    bytes_freed += sizeof(voter);
+    output_write("\t", 1);
+    output_int(v->pin);
+    output_write("\n", 1);
 }
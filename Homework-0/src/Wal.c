@@ -0,0 +1,486 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../include/Wal.h"
+#include "../include/Voter.h"
+
+#define WAL_BUFFER_INITIAL_CAPACITY 4096      // bytes of the buffers records are gathered in
+#define WAL_HEADER_SIZE 16                    // magic and base
+#define WAL_RECORD_HEADER_SIZE 8              // payload_size and checksum
+#define WAL_INSERT_FIXED_SIZE 14              // type, pin, zipcode, name_len, surname_len and has_voted
+#define WAL_MARK_SIZE 5                       // type and pin
+#define WAL_DELETE_SIZE 5                     // type and pin
+
+
+// ------------------------------ STRUCTS ------------------------------ //
+typedef struct wal {
+    int             fd;                   // The file descriptor of the log
+    char*           file_name;            // The name of the log
+    uint64_t        base;                 // The file the records were logged on top of
+    char*           buffer;               // The records logged, but not yet written
+    size_t          used;                 // The bytes of the records in buffer
+    size_t          capacity;             // The capacity of buffer
+    char*           spare;                // The buffer being written while records are logged into buffer
+    size_t          spare_capacity;       // The capacity of spare
+    int             n_pending;            // The number of records in buffer
+    int             group_records;        // Records are committed once that many are pending
+    int             group_ms;             // or once the first of them has waited that many ms
+    struct timespec deadline;             // The time the records pending must be committed by
+    bool            flushing;             // Whether spare is being written at the moment
+    bool            closing;              // Whether the flusher has to stop
+    pthread_mutex_t lock;                 // Guards everything above
+    pthread_cond_t  pending;              // Signaled when the first record of a group is logged
+    pthread_cond_t  flushed;              // Signaled when spare has been written
+    pthread_t       flusher;              // Commits the groups whose deadline has passed
+} wal;
+
+
+// ------------------------------ ENCODING ------------------------------ //
+
+// FNV-1a over the size bytes of data
+static uint32_t wal_checksum(const char* data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for(size_t i = 0; i < size; i++) {
+        hash ^= (unsigned char) data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static char* put_bytes(char* cursor, const void* data, size_t size) {
+    memcpy(cursor, data, size);
+    return cursor + size;
+}
+
+// Parses the record starting at data, of the size bytes left in the log, into
+// record. Returns its total size, or 0 if it is cut short or corrupted
+static size_t wal_parse_record(const char* data, size_t size, WalRecord* record) {
+    uint32_t payload_size, checksum;
+    if(size < WAL_RECORD_HEADER_SIZE)
+        return 0;
+    memcpy(&payload_size, data, sizeof(uint32_t));
+    memcpy(&checksum, data + sizeof(uint32_t), sizeof(uint32_t));
+
+    const char* payload = data + WAL_RECORD_HEADER_SIZE;
+    if(payload_size == 0 || payload_size > size - WAL_RECORD_HEADER_SIZE)
+        return 0;
+    if(wal_checksum(payload, payload_size) != checksum)
+        return 0;
+
+    record->type = (WalType) payload[0];
+    if((record->type == WAL_MARK && payload_size == WAL_MARK_SIZE)
+       || (record->type == WAL_DELETE && payload_size == WAL_DELETE_SIZE)) {
+        int32_t pin;
+        memcpy(&pin, payload + 1, sizeof(int32_t));
+        record->pin = pin;
+        return WAL_RECORD_HEADER_SIZE + payload_size;
+    }
+    if(record->type == WAL_INSERT && payload_size >= WAL_INSERT_FIXED_SIZE) {
+        int32_t pin, zipcode;
+        uint16_t name_len, surname_len;
+        memcpy(&pin, payload + 1, sizeof(int32_t));
+        memcpy(&zipcode, payload + 5, sizeof(int32_t));
+        memcpy(&name_len, payload + 9, sizeof(uint16_t));
+        memcpy(&surname_len, payload + 11, sizeof(uint16_t));
+        if(payload_size != WAL_INSERT_FIXED_SIZE + (size_t)name_len + surname_len)
+            return 0;
+
+        record->pin         = pin;
+        record->zipcode     = zipcode;
+        record->has_voted   = (payload[13] != 0);
+        record->name        = payload + WAL_INSERT_FIXED_SIZE;
+        record->name_len    = name_len;
+        record->surname     = record->name + name_len;
+        record->surname_len = surname_len;
+        return WAL_RECORD_HEADER_SIZE + payload_size;
+    }
+    return 0;
+}
+
+
+// ------------------------------ COMMITTING ------------------------------ //
+
+static void write_all(int fd, const char* data, size_t size) {
+    while(size > 0) {
+        ssize_t written = write(fd, data, size);
+        if(written < 0) {
+            if(errno == EINTR)
+                continue;
+            fprintf(stderr, "Error: WAL write failure | While writing %zu bytes.\n", size);
+            exit(EXIT_FAILURE);
+        }
+        data += written;
+        size -= written;
+    }
+}
+
+// Writes the header of a log with the given base at the end of the file fd
+static void wal_write_header(int fd, uint64_t base) {
+    char header[WAL_HEADER_SIZE];
+    char* cursor = put_bytes(header, WAL_MAGIC, sizeof(WAL_MAGIC) - 1);
+    put_bytes(cursor, &base, sizeof(uint64_t));
+    write_all(fd, header, WAL_HEADER_SIZE);
+}
+
+// Writes and fsyncs the records pending. It is called with W->lock held, which is
+// released while writing, so that new records can be logged meanwhile into the other
+// buffer. Only one group is written at a time
+static void wal_flush(const Wal W) {
+    while(W->flushing)
+        pthread_cond_wait(&W->flushed, &W->lock);
+
+    if(W->used == 0)
+        return;
+
+    // Swap the buffers, and write the one that was filled
+    char* group = W->buffer;
+    size_t size = W->used;
+    size_t capacity = W->capacity;
+    W->buffer = W->spare;
+    W->capacity = W->spare_capacity;
+    W->spare = group;
+    W->spare_capacity = capacity;
+    W->used = 0;
+    W->n_pending = 0;
+    W->flushing = true;
+
+    pthread_mutex_unlock(&W->lock);
+    write_all(W->fd, group, size);
+    if(fdatasync(W->fd) != 0) {
+        fprintf(stderr, "Error: WAL fsync failure.\n");
+        exit(EXIT_FAILURE);
+    }
+    pthread_mutex_lock(&W->lock);
+
+    W->flushing = false;
+    pthread_cond_broadcast(&W->flushed);
+}
+
+// Commits each group whose first record has waited for group_ms
+static void* wal_flusher(void* argument) {
+    Wal W = argument;
+
+    pthread_mutex_lock(&W->lock);
+    while(!W->closing) {
+        if(W->n_pending == 0) {
+            pthread_cond_wait(&W->pending, &W->lock);
+            continue;
+        }
+
+        struct timespec deadline = W->deadline;
+        if(pthread_cond_timedwait(&W->pending, &W->lock, &deadline) == ETIMEDOUT && W->n_pending > 0)
+            wal_flush(W);
+    }
+    pthread_mutex_unlock(&W->lock);
+
+    return NULL;
+}
+
+// Reserves size bytes at the end of the buffer, for a new record. Called with W->lock held
+static char* wal_reserve(const Wal W, size_t size) {
+    if(W->used + size > W->capacity) {
+        size_t capacity = W->capacity;
+        while(W->used + size > capacity)
+            capacity *= 2;
+
+        char* buffer = realloc(W->buffer, capacity);
+        if(buffer == NULL) {
+            fprintf(stderr, "Error: Memory allocation failure | While allocating memory for: WAL buffer.\n");
+            exit(EXIT_FAILURE);
+        }
+        W->buffer = buffer;
+        W->capacity = capacity;
+    }
+
+    char* record = W->buffer + W->used;
+    W->used += size;
+    return record;
+}
+
+// Seals the record of payload_size bytes that was reserved at record, and commits
+// the group if it is full. Called with W->lock held
+static void wal_append(const Wal W, char* record, uint32_t payload_size) {
+    uint32_t checksum = wal_checksum(record + WAL_RECORD_HEADER_SIZE, payload_size);
+    record = put_bytes(record, &payload_size, sizeof(uint32_t));
+    put_bytes(record, &checksum, sizeof(uint32_t));
+
+    if(W->n_pending++ == 0) {
+        // The first record of the group sets the deadline of the whole group
+        clock_gettime(CLOCK_MONOTONIC, &W->deadline);
+        W->deadline.tv_sec  += W->group_ms / 1000;
+        W->deadline.tv_nsec += (long)(W->group_ms % 1000) * 1000000L;
+        if(W->deadline.tv_nsec >= 1000000000L) {
+            W->deadline.tv_sec++;
+            W->deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_signal(&W->pending);
+    }
+
+    if(W->n_pending >= W->group_records)
+        wal_flush(W);
+}
+
+
+// ------------------------------ WAL ------------------------------ //
+
+// Checks the header of the log (writing it first, if the log is new), and hands every
+// record of the log to apply. A last record cut short by a crash is dropped
+static void wal_replay(const Wal W, uint64_t base, uint64_t saved_base, WalApply apply, Pointer context) {
+    struct stat file_stat;
+    if(fstat(W->fd, &file_stat) != 0) {
+        fprintf(stderr, "Error occurred while opening the WAL %s.\n", W->file_name);
+        exit(EXIT_FAILURE);
+    }
+
+    size_t file_size = file_stat.st_size;
+    if(file_size == 0) {
+        wal_write_header(W->fd, base);
+        if(fsync(W->fd) != 0) {
+            fprintf(stderr, "Error: WAL fsync failure.\n");
+            exit(EXIT_FAILURE);
+        }
+        W->base = base;
+        return;
+    }
+
+    const char* data = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, W->fd, 0);
+    if(data == MAP_FAILED) {
+        fprintf(stderr, "Error occurred while mapping the WAL %s.\n", W->file_name);
+        exit(EXIT_FAILURE);
+    }
+    madvise((void*)data, file_size, MADV_SEQUENTIAL);
+
+    if(file_size < WAL_HEADER_SIZE || memcmp(data, WAL_MAGIC, sizeof(WAL_MAGIC) - 1) != 0) {
+        fprintf(stderr, "Error: %s is not a WAL (of this version).\n", W->file_name);
+        exit(EXIT_FAILURE);
+    }
+
+    // The records must have been logged on top of the file the DataBase was loaded from
+    memcpy(&W->base, data + sizeof(WAL_MAGIC) - 1, sizeof(uint64_t));
+    if(W->base != base && W->base != saved_base) {
+        fprintf(stderr, "Error: The WAL %s was logged on top of another file than the one given, "
+                        "and is not replayed.\n", W->file_name);
+        exit(EXIT_FAILURE);
+    }
+
+    size_t offset = WAL_HEADER_SIZE;
+    WalRecord record;
+    size_t record_size;
+    while((record_size = wal_parse_record(data + offset, file_size - offset, &record)) > 0) {
+        apply(&record, context);
+        offset += record_size;
+    }
+    munmap((void*)data, file_size);
+
+    if(offset < file_size) {
+        fprintf(stderr, "Warning: Dropped the last %zu bytes of the WAL %s, as they are incomplete.\n", file_size - offset, W->file_name);
+        if(ftruncate(W->fd, offset) != 0) {
+            fprintf(stderr, "Error occurred while truncating the WAL %s.\n", W->file_name);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+Wal wal_open(const char* file_name, uint64_t base, uint64_t saved_base, int group_records, int group_ms,
+             WalApply apply, Pointer context) {
+    assert(file_name != NULL);
+    assert(group_records > 0 && group_ms > 0);
+
+    Wal W = malloc(sizeof(wal));
+    if(W == NULL) {
+        fprintf(stderr, "Error: Memory allocation failure | While allocating memory for: WAL.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    W->fd = open(file_name, O_RDWR | O_CREAT | O_APPEND, 0644);
+    if(W->fd < 0) {
+        fprintf(stderr, "Error: WAL %s could not be opened.\n", file_name);
+        exit(EXIT_FAILURE);
+    }
+
+    W->file_name = malloc(strlen(file_name) + 1);
+    if(W->file_name == NULL) {
+        fprintf(stderr, "Error: Memory allocation failure | While allocating memory for: WAL file name.\n");
+        exit(EXIT_FAILURE);
+    }
+    strcpy(W->file_name, file_name);
+
+    W->buffer = malloc(WAL_BUFFER_INITIAL_CAPACITY);
+    W->spare  = malloc(WAL_BUFFER_INITIAL_CAPACITY);
+    if(W->buffer == NULL || W->spare == NULL) {
+        fprintf(stderr, "Error: Memory allocation failure | While allocating memory for: WAL buffer.\n");
+        exit(EXIT_FAILURE);
+    }
+    W->used = 0;
+    W->capacity = W->spare_capacity = WAL_BUFFER_INITIAL_CAPACITY;
+    W->n_pending = 0;
+    W->group_records = group_records;
+    W->group_ms = group_ms;
+    W->flushing = false;
+    W->closing = false;
+
+    wal_replay(W, base, saved_base, apply, context);
+
+    // The deadlines are on the monotonic clock, so the timed waits must be as well
+    pthread_condattr_t attributes;
+    pthread_condattr_init(&attributes);
+    pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+    pthread_mutex_init(&W->lock, NULL);
+    pthread_cond_init(&W->pending, &attributes);
+    pthread_cond_init(&W->flushed, NULL);
+    pthread_condattr_destroy(&attributes);
+
+    if(pthread_create(&W->flusher, NULL, wal_flusher, W) != 0) {
+        fprintf(stderr, "Error: Thread creation failure | While starting the WAL flusher.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    return W;
+}
+
+uint64_t wal_base(const Wal W) {
+    assert(W != NULL);
+
+    return W->base;
+}
+
+void wal_log_insert(const Wal W, const Voter V) {
+    assert(W != NULL);
+    assert(V != NULL);
+
+    const char* name    = voter_get_name(V);
+    const char* surname = voter_get_surname(V);
+    int32_t  pin = voter_get_pin(V), zipcode = voter_get_zip(V);
+    uint16_t name_len = strlen(name), surname_len = strlen(surname);
+    uint32_t payload_size = WAL_INSERT_FIXED_SIZE + name_len + surname_len;
+    char type = WAL_INSERT;
+
+    pthread_mutex_lock(&W->lock);
+
+    char has_voted = voter_has_voted(V);
+    char* record = wal_reserve(W, WAL_RECORD_HEADER_SIZE + payload_size);
+    char* cursor = record + WAL_RECORD_HEADER_SIZE;
+    cursor = put_bytes(cursor, &type, 1);
+    cursor = put_bytes(cursor, &pin, sizeof(int32_t));
+    cursor = put_bytes(cursor, &zipcode, sizeof(int32_t));
+    cursor = put_bytes(cursor, &name_len, sizeof(uint16_t));
+    cursor = put_bytes(cursor, &surname_len, sizeof(uint16_t));
+    cursor = put_bytes(cursor, &has_voted, 1);
+    cursor = put_bytes(cursor, name, name_len);
+    put_bytes(cursor, surname, surname_len);
+    wal_append(W, record, payload_size);
+
+    pthread_mutex_unlock(&W->lock);
+}
+
+// Logs a record of the given type that only holds a pin (of size type and pin)
+static void wal_log_pin(const Wal W, WalType wal_type, int pin) {
+    assert(W != NULL);
+
+    int32_t pin32 = pin;
+    char type = wal_type;
+
+    pthread_mutex_lock(&W->lock);
+
+    char* record = wal_reserve(W, WAL_RECORD_HEADER_SIZE + 1 + sizeof(int32_t));
+    char* cursor = record + WAL_RECORD_HEADER_SIZE;
+    cursor = put_bytes(cursor, &type, 1);
+    put_bytes(cursor, &pin32, sizeof(int32_t));
+    wal_append(W, record, 1 + sizeof(int32_t));
+
+    pthread_mutex_unlock(&W->lock);
+}
+
+void wal_log_mark(const Wal W, int pin) {
+    wal_log_pin(W, WAL_MARK, pin);
+}
+
+void wal_log_delete(const Wal W, int pin) {
+    wal_log_pin(W, WAL_DELETE, pin);
+}
+
+void wal_commit(const Wal W) {
+    assert(W != NULL);
+
+    pthread_mutex_lock(&W->lock);
+    wal_flush(W);
+    // wal_flush does not wait for a group it did not write itself
+    while(W->flushing)
+        pthread_cond_wait(&W->flushed, &W->lock);
+    pthread_mutex_unlock(&W->lock);
+}
+
+// The emptied log is written next to the log, and only replaces it once its
+// header is on disk, so that a crash never leaves a log without a header
+bool wal_truncate(const Wal W, uint64_t base) {
+    assert(W != NULL);
+
+    size_t len = strlen(W->file_name);
+    char* temp_path = malloc(len + sizeof(".tmp"));
+    if(temp_path == NULL) {
+        fprintf(stderr, "Error: Memory allocation failure | While allocating memory for: temp_path.\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(temp_path, W->file_name, len);
+    memcpy(temp_path + len, ".tmp", sizeof(".tmp"));
+
+    pthread_mutex_lock(&W->lock);
+    wal_flush(W);
+    while(W->flushing)
+        pthread_cond_wait(&W->flushed, &W->lock);
+
+    bool truncated = false;
+    int fd = open(temp_path, O_RDWR | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if(fd >= 0) {
+        wal_write_header(fd, base);
+        truncated = (fsync(fd) == 0 && rename(temp_path, W->file_name) == 0);
+        if(truncated) {
+            close(W->fd);
+            W->fd = fd;
+            W->base = base;
+        }
+        else {
+            close(fd);
+            remove(temp_path);
+        }
+    }
+    pthread_mutex_unlock(&W->lock);
+
+    free(temp_path);
+    return truncated;
+}
+
+void wal_close(const Wal W) {
+    if(W == NULL)
+        return;
+
+    pthread_mutex_lock(&W->lock);
+    W->closing = true;
+    pthread_cond_signal(&W->pending);
+    pthread_mutex_unlock(&W->lock);
+    pthread_join(W->flusher, NULL);
+
+    wal_commit(W);
+    close(W->fd);
+
+    pthread_mutex_destroy(&W->lock);
+    pthread_cond_destroy(&W->pending);
+    pthread_cond_destroy(&W->flushed);
+
+    free(W->buffer);
+    free(W->spare);
+    bytes_freed += W->capacity + W->spare_capacity;
+    bytes_freed += strlen(W->file_name) + 1;
+    free(W->file_name);
+    free(W);
+    bytes_freed += sizeof(wal);
+}
@@ -4,20 +4,19 @@
 #include "../include/utils.h"
 #include "../include/Command.h"
 
-#define TOTAL_N_ARGS 7
-#define LOAD_THRESHOLD 0.75
+#define MIN_N_ARGS 7             // -f, -b and -m are mandatory
+#define MAX_N_ARGS 23            // -n, -t, -h, -w, -c, -d, -S and -l are optional
+#define LOAD_THRESHOLD 0.75      // default load factor that triggers a split (-l)
 
 
 int main(int argc, char* argv[]) {
 
-    char* file_name = NULL;
-    int bucket_size;
-    int m;
+    Args args;
 
-    if(!validArgs(argc, argv, &file_name, &bucket_size, &m, TOTAL_N_ARGS))
+    if(!validArgs(argc, argv, &args, MIN_N_ARGS, MAX_N_ARGS))
         return 1;
 
-    RunDB(file_name, m, bucket_size, LOAD_THRESHOLD);
+    RunDB(&args, args.load_threshold > 0 ? args.load_threshold : LOAD_THRESHOLD);
     
     return 0;
 }
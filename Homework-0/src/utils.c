@@ -1,15 +1,18 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
 #include "../include/utils.h"
 
 
 // ------------------------------ UTILS ------------------------------ //
 
 // As a first filter, this function simply checks if the number of
-// arguments is equal to the expected number of total arguments.
-static bool validNumberOfArgs(int argc, int total_args) {
-    if (argc != total_args) {
+// arguments is within the expected range of total arguments.
+static bool validNumberOfArgs(int argc, int min_args, int max_args) {
+    if (argc < min_args || argc > max_args) {
         printf("Not accepted number of command-line arguments.\n");
         return false;
     }
@@ -78,56 +81,233 @@ bool isPositiveIntegerNumber(const char* str) {
     return true;
 }
 
+// Given a string, the function below checks if the string is a positive
+// integer number that also fits in an int, and stores it in value.
+bool isPositiveInt(const char* str, int* value) {
+    if (!isPositiveIntegerNumber(str))
+        return false;
+
+    errno = 0;
+    unsigned long number = strtoul(str, NULL, 10);
+    if (errno == ERANGE || number > INT_MAX)
+        return false;
+
+    *value = (int)number;
+    return true;
+}
+
+// Given a string, the function below checks if the string is a positive
+// integer number that also fits in a size_t, and stores it in value.
+bool isPositiveSize(const char* str, size_t* value) {
+    if (!isPositiveIntegerNumber(str))
+        return false;
+
+    errno = 0;
+    unsigned long long number = strtoull(str, NULL, 10);
+    if (errno == ERANGE || number > SIZE_MAX)
+        return false;
+
+    *value = (size_t)number;
+    return true;
+}
+
+// Given a string, the function below checks if the whole string is
+// a positive real number (such as 0.75 or 2), and stores it in value.
+bool isPositiveRealNumber(const char* str, float* value) {
+    if (str == NULL || *str == '\0')
+        return false;
+
+    char* end;
+    float number = strtof(str, &end);
+    if (*end != '\0' || !(number > 0))         // also rejects nan
+        return false;
+
+    *value = number;
+    return true;
+}
+
 void clearInput(void) {
     int c;
     while ((c = getchar()) != '\n' && c != EOF);
 }
 
+// Checks if every mandatory flag (-f, -b, -m) has been given
+static bool mandatoryArgsGiven(const Args* args) {
+    if (args->file_name == NULL || args->bucket_size == 0 || args->m == 0) {
+        fprintf(stderr, "Error: -f, -b and -m options are all required.\n");
+        return false;
+    }
+    return true;
+}
+
+// Frees the strings of args, in case validArgs fails
+static void freeArgs(Args* args) {
+    if(args->file_name != NULL)
+        free(args->file_name);
+    if(args->wal_file != NULL)
+        free(args->wal_file);
+    if(args->socket_path != NULL)
+        free(args->socket_path);
+}
+
+// Copies the argument of a string flag (such as -f) into *dest, unless
+// the flag has already been given
+static bool copyStringArg(char** dest, const char* flag, const char* value) {
+    if (*dest != NULL) {
+        fprintf(stderr, "Error: %s option given more than once.\n", flag);
+        return false;
+    }
+
+    *dest = malloc(sizeof(char) * (strlen(value) + 1));
+    if (*dest == NULL) {
+        fprintf(stderr, "Error: Memory allocation failure | While allocating memory for: %s argument.\n", flag);
+        exit(EXIT_FAILURE);
+    }
+    strcpy(*dest, value);
+    return true;
+}
+
 // This function is responsible for reading the command line arguments passed
 // from the user, in initial execution of the program. It makes some filtering
-// as well, before initializing the variables: 
+// as well, before initializing the fields of args: 
 //    file_name   : the file we are going to initialize our database with
 //    bucket_size : the size of the buckets in the hashtable
 //    m           : the initial size of the hashtable
-bool validArgs(int argc, char** argv, char** file_name, int* bucket_size, int* m, int max_args) {
-    if(!validNumberOfArgs(argc, max_args))
+//    n_rows_hint : (optional, -n) the expected number of voters in file_name
+//    n_threads   : (optional, -t) the number of threads loading file_name
+//    hash_kind   : (optional, -h) the hash family of the hashtable (modulo, fibonacci or murmur)
+//    wal_file    : (optional, -w) the write-ahead log the changes on the database are kept in
+//    group_records, group_ms : (optional, -c, -d) when the records of the log are committed
+//    socket_path : (optional, -S) the Unix socket the commands are served on, instead of stdin
+//    load_threshold : (optional, -l) the load factor of the hashtable that triggers a split
+bool validArgs(int argc, char** argv, Args* args, int min_args, int max_args) {
+    args->file_name   = NULL;
+    args->bucket_size = 0;
+    args->m           = 0;
+    args->n_rows_hint = 0;
+    args->n_threads   = 1;
+    args->hash_kind   = HASH_MODULO;
+    args->wal_file    = NULL;
+    args->group_records = WAL_GROUP_RECORDS;
+    args->group_ms      = WAL_GROUP_MS;
+    args->socket_path   = NULL;
+    args->load_threshold = 0;
+
+    if(!validNumberOfArgs(argc, min_args, max_args))
         return false;
 
     for (int i = 1; i < argc; i++) {
-        if (strcmp(argv[i], "-f") == 0) {
-            int len = strlen(argv[i+1]);
-            *file_name = malloc(sizeof(char) * (len+1));
-            strcpy(*file_name, argv[i+1]);
+        if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            if (!copyStringArg(&args->file_name, "-f", argv[i+1])) {
+                freeArgs(args);
+                return false;
+            }
             i++;
-        } 
+        }
         else if (strcmp(argv[i], "-b") == 0) {
-            if ( (i + 1 < argc) && isPositiveIntegerNumber(argv[i+1]) ) {
-                *bucket_size = atoi(argv[i+1]);
+            if ( (i + 1 < argc) && isPositiveInt(argv[i+1], &args->bucket_size) ) {
                 i++;
             }
             else {
-                fprintf(stderr, "Error: -b option requires a positive integer argument.\n");
-                if(*file_name != NULL)
-                    free(*file_name);
+                fprintf(stderr, "Error: -b option requires a positive integer argument (at most %d).\n", INT_MAX);
+                freeArgs(args);
                 return false;
             }
         }
         else if (strcmp(argv[i], "-m") == 0) {
-            if ( (i + 1 < argc) && isPositiveIntegerNumber(argv[i+1]) ) {
-                *m = atoi(argv[i+1]);
+            if ( (i + 1 < argc) && isPositiveInt(argv[i+1], &args->m) ) {
+                i++;
+            }
+            else {
+                fprintf(stderr, "Error: -m option requires a positive integer argument (at most %d).\n", INT_MAX);
+                freeArgs(args);
+                return false;
+            }
+        } 
+        else if (strcmp(argv[i], "-n") == 0) {
+            if ( (i + 1 < argc) && isPositiveSize(argv[i+1], &args->n_rows_hint) ) {
+                i++;
+            }
+            else {
+                fprintf(stderr, "Error: -n option requires a positive integer argument.\n");
+                freeArgs(args);
+                return false;
+            }
+        } 
+        else if (strcmp(argv[i], "-t") == 0) {
+            if ( (i + 1 < argc) && isPositiveInt(argv[i+1], &args->n_threads) ) {
+                i++;
+            }
+            else {
+                fprintf(stderr, "Error: -t option requires a positive integer argument (at most %d).\n", INT_MAX);
+                freeArgs(args);
+                return false;
+            }
+        } 
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            if (!copyStringArg(&args->wal_file, "-w", argv[i+1])) {
+                freeArgs(args);
+                return false;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "-S") == 0 && i + 1 < argc) {
+            if (!copyStringArg(&args->socket_path, "-S", argv[i+1])) {
+                freeArgs(args);
+                return false;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "-c") == 0) {
+            if ( (i + 1 < argc) && isPositiveInt(argv[i+1], &args->group_records) ) {
+                i++;
+            }
+            else {
+                fprintf(stderr, "Error: -c option requires a positive integer argument (at most %d).\n", INT_MAX);
+                freeArgs(args);
+                return false;
+            }
+        } 
+        else if (strcmp(argv[i], "-d") == 0) {
+            if ( (i + 1 < argc) && isPositiveInt(argv[i+1], &args->group_ms) ) {
+                i++;
+            }
+            else {
+                fprintf(stderr, "Error: -d option requires a positive integer argument (at most %d).\n", INT_MAX);
+                freeArgs(args);
+                return false;
+            }
+        } 
+        else if (strcmp(argv[i], "-l") == 0) {
+            if ( (i + 1 < argc) && isPositiveRealNumber(argv[i+1], &args->load_threshold) ) {
                 i++;
             }
             else {
-                fprintf(stderr, "Error: -m option requires a positive integer argument.\n");
-                if(*file_name != NULL)
-                    free(*file_name);
+                fprintf(stderr, "Error: -l option requires a positive real argument.\n");
+                freeArgs(args);
+                return false;
+            }
+        } 
+        else if (strcmp(argv[i], "-h") == 0) {
+            if ( (i + 1 < argc) && hash_kind_from_name(argv[i+1], &args->hash_kind) ) {
+                i++;
+            }
+            else {
+                fprintf(stderr, "Error: -h option requires one of: modulo, fibonacci, murmur.\n");
+                freeArgs(args);
                 return false;
             }
         } 
         else {
             fprintf(stderr, "Non recognized command-line argument: %s\n", argv[i]);
+            freeArgs(args);
             return false;
         }
     }
+
+    if(!mandatoryArgsGiven(args)) {
+        freeArgs(args);
+        return false;
+    }
     return true;
 }
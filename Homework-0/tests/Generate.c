@@ -0,0 +1,232 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+// ------------------------------ GENERATE ------------------------------ //
+//
+// Writes a synthetic voter file of any size, in the format of the files mvote
+// is initialized with (one "pin surname name zipcode" line per voter):
+//
+//      ./Generate -n <voters> [-o <file>] [-p sequential|random|clustered]
+//                 [-c <cluster size>] [-z <zipcodes>] [-s <skew>] [-r <seed>]
+//
+//      -n : number of voters (at most 2^30)
+//      -o : output file (stdout if not given)
+//      -p : distribution of the pins (sequential if not given)
+//              sequential: 1, 2, ..., n
+//              random:     n distinct pins spread all over [1, 2^30]
+//              clustered:  runs of -c consecutive pins, the runs spread all over [1, 2^30]
+//      -c : size of the runs of clustered pins (1000 if not given)
+//      -z : number of distinct zipcodes (100 if not given)
+//      -s : skew of the zipcodes, the exponent of a Zipf distribution over them
+//           (0, that is uniform, if not given; 1 is the classic Zipf skew)
+//      -r : seed of the generator (1 if not given), the same seed gives the same file
+
+#define PIN_BITS 30                 // pins are within [1, 2^PIN_BITS]
+#define FIRST_ZIPCODE 1000          // zipcodes are FIRST_ZIPCODE, FIRST_ZIPCODE + 1, ...
+
+typedef enum { PINS_SEQUENTIAL, PINS_RANDOM, PINS_CLUSTERED } PinKind;
+
+// ------------------------------ RANDOM ------------------------------ //
+
+static uint64_t rng_state;
+
+// splitmix64: fast, and good enough for test data
+static uint64_t rng_next(void) {
+    uint64_t z = (rng_state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Uniform in [0, 1)
+static double rng_real(void) {
+    return (double)(rng_next() >> 11) / (double)(1ULL << 53);
+}
+
+// A bijection over the integers of bits bits (keyed by the seed), so that
+// the distinct indices 0, 1, ... of the voters map to distinct pins that
+// look random, without keeping track of the pins handed out so far
+static uint64_t scramble(uint64_t x, int bits, uint64_t key) {
+    uint64_t mask = (1ULL << bits) - 1;
+    for (int round = 0; round < 3; round++) {
+        x = (x ^ key) & mask;
+        x = (x * 0x2545F4914F6CDD1DULL) & mask;        // odd multiplier: invertible modulo 2^bits
+        x ^= x >> (bits / 2 + 1);
+        key = key * 0x9E3779B97F4A7C15ULL + 1;
+    }
+    return x;
+}
+
+// ------------------------------ PINS ------------------------------ //
+
+// Returns the log2 of the slot of pins each run of clustered pins owns: the
+// least power of 2 that is at least twice cluster_size
+static int cluster_shift(int cluster_size) {
+    int shift = 1;
+    while ((1ULL << shift) < 2 * (uint64_t)cluster_size)
+        shift++;
+    return shift;
+}
+
+// Returns the pin of the i-th voter
+static int pin_of(uint64_t i, PinKind kind, int cluster_size, uint64_t key) {
+    switch (kind) {
+        case PINS_RANDOM:
+            return (int)scramble(i, PIN_BITS, key) + 1;
+
+        case PINS_CLUSTERED: {
+            // every run owns a slot of 2^shift pins (at least twice its size, so that
+            // runs never touch), and the slots of the runs are scrambled
+            int shift = cluster_shift(cluster_size);
+            uint64_t run = i / cluster_size, offset = i % cluster_size;
+            return (int)((scramble(run, PIN_BITS - shift, key) << shift) + offset) + 1;
+        }
+
+        default:
+            return (int)i + 1;
+    }
+}
+
+// ------------------------------ ZIPCODES ------------------------------ //
+
+// Builds the cumulative distribution of n_zipcodes zipcodes, where the zipcode
+// of rank r (starting from 1) has weight 1 / r^skew
+static double* zipcodes_cdf(int n_zipcodes, double skew) {
+    double* cdf = malloc(sizeof(double) * n_zipcodes);
+    if (cdf == NULL) {
+        fprintf(stderr, "Error: Memory allocation failure | While allocating memory for: cdf.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    double total = 0;
+    for (int r = 0; r < n_zipcodes; r++) {
+        total += 1.0 / pow(r + 1, skew);
+        cdf[r] = total;
+    }
+    for (int r = 0; r < n_zipcodes; r++)
+        cdf[r] /= total;
+
+    return cdf;
+}
+
+// Draws a zipcode out of the distribution cdf (binary search for the first rank
+// whose cumulative weight exceeds a uniform draw)
+static int zipcode_draw(const double* cdf, int n_zipcodes) {
+    double u = rng_real();
+    int low = 0, high = n_zipcodes - 1;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (cdf[mid] > u)
+            high = mid;
+        else
+            low = mid + 1;
+    }
+    return FIRST_ZIPCODE + low;
+}
+
+// ------------------------------ NAMES ------------------------------ //
+
+static const char* syllables[] = {
+    "BA", "DE", "KI", "LO", "MA", "NE", "RI", "SO", "TA", "VE",
+    "AN", "ER", "ON", "EL", "IS", "AR", "OS", "UN", "TH", "CH"
+};
+
+// Writes a random name of 2 to 5 syllables in name
+static void name_draw(char* name) {
+    int n_syllables = 2 + (int)(rng_next() % 4);
+    name[0] = '\0';
+    for (int s = 0; s < n_syllables; s++)
+        strcat(name, syllables[rng_next() % (sizeof(syllables) / sizeof(syllables[0]))]);
+}
+
+// ------------------------------ MAIN ------------------------------ //
+
+static void usage(void) {
+    fprintf(stderr, "Usage: ./Generate -n <voters> [-o <file>] [-p sequential|random|clustered]\n"
+                    "                  [-c <cluster size>] [-z <zipcodes>] [-s <skew>] [-r <seed>]\n");
+}
+
+int main(int argc, char* argv[]) {
+    long long n_voters = 0;
+    const char* file_name = NULL;
+    PinKind kind = PINS_SEQUENTIAL;
+    int cluster_size = 1000;
+    int n_zipcodes = 100;
+    double skew = 0;
+    uint64_t seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            usage();
+            return 1;
+        }
+        const char* value = argv[++i];
+
+        if (strcmp(argv[i-1], "-n") == 0)
+            n_voters = atoll(value);
+        else if (strcmp(argv[i-1], "-o") == 0)
+            file_name = value;
+        else if (strcmp(argv[i-1], "-c") == 0)
+            cluster_size = atoi(value);
+        else if (strcmp(argv[i-1], "-z") == 0)
+            n_zipcodes = atoi(value);
+        else if (strcmp(argv[i-1], "-s") == 0)
+            skew = atof(value);
+        else if (strcmp(argv[i-1], "-r") == 0)
+            seed = strtoull(value, NULL, 10);
+        else if (strcmp(argv[i-1], "-p") == 0) {
+            if (strcmp(value, "sequential") == 0)
+                kind = PINS_SEQUENTIAL;
+            else if (strcmp(value, "random") == 0)
+                kind = PINS_RANDOM;
+            else if (strcmp(value, "clustered") == 0)
+                kind = PINS_CLUSTERED;
+            else {
+                usage();
+                return 1;
+            }
+        }
+        else {
+            usage();
+            return 1;
+        }
+    }
+
+    if (n_voters <= 0 || n_voters > (1LL << PIN_BITS) || cluster_size <= 0
+        || cluster_size > (1 << (PIN_BITS - 2)) || n_zipcodes <= 0 || skew < 0) {
+        usage();
+        return 1;
+    }
+    // Every run needs a slot of its own, and there are 2^(PIN_BITS - shift) slots
+    if (kind == PINS_CLUSTERED
+        && (n_voters + cluster_size - 1) / cluster_size > (1LL << (PIN_BITS - cluster_shift(cluster_size)))) {
+        fprintf(stderr, "Error: too many voters for clusters of %d pins.\n", cluster_size);
+        return 1;
+    }
+
+    FILE* file = stdout;
+    if (file_name != NULL && (file = fopen(file_name, "w")) == NULL) {
+        fprintf(stderr, "Error: could not open %s.\n", file_name);
+        return 1;
+    }
+
+    rng_state = seed;
+    uint64_t key = rng_next();
+    double* cdf = zipcodes_cdf(n_zipcodes, skew);
+
+    char name[16], surname[16];
+    for (long long i = 0; i < n_voters; i++) {
+        name_draw(surname);
+        name_draw(name);
+        fprintf(file, "%d %s %s %d\n", pin_of(i, kind, cluster_size, key), surname, name, zipcode_draw(cdf, n_zipcodes));
+    }
+
+    free(cdf);
+    if (file != stdout)
+        fclose(file);
+    return 0;
+}
@@ -0,0 +1,120 @@
+#!/bin/bash
+#
+# ------------------------------ BENCH ------------------------------ #
+#
+# Measures mvote on a voter file made by Generate, for every combination of
+# the given bucket sizes (-b), initial table sizes (-m) and load thresholds (-l):
+#
+#       load   : time to initialize the database from the file (ms)
+#       l, m   : throughput of l and m commands on random existing pins (commands/s)
+#       bv     : throughput of bv (quiet) on a file of random existing pins (pins/s)
+#       o      : time of an o command, once the voters of the bv file have voted (ms)
+#
+# Every command but load is timed as the difference of two runs, one with and
+# one without the commands measured, so that the load time cancels out. Every
+# run is repeated and the fastest repetition is kept.
+#
+#       ./bench.sh [-n <voters>] [-p sequential|random|clustered] [-z <zipcodes>]
+#                  [-s <skew>] [-b "<sizes>"] [-m "<sizes>"] [-l "<thresholds>"]
+#                  [-k <commands>] [-o <o commands>] [-t <threads>] [-r <repetitions>]
+#
+# The arguments of -b, -m and -l are lists, such as -b "1 4 16". Run it from
+# the tests directory; mvote and Generate are built first if they need to be.
+
+set -e
+
+VOTERS=100000
+PINS=random
+ZIPCODES=100
+SKEW=1
+BUCKETS="1 4 16"
+SIZES="2 1024"
+THRESHOLDS="0.75"
+COMMANDS=20000
+O_COMMANDS=100
+THREADS=1
+REPETITIONS=3
+
+while getopts "n:p:z:s:b:m:l:k:o:t:r:" option; do
+    case $option in
+        n) VOTERS=$OPTARG ;;
+        p) PINS=$OPTARG ;;
+        z) ZIPCODES=$OPTARG ;;
+        s) SKEW=$OPTARG ;;
+        b) BUCKETS=$OPTARG ;;
+        m) SIZES=$OPTARG ;;
+        l) THRESHOLDS=$OPTARG ;;
+        k) COMMANDS=$OPTARG ;;
+        o) O_COMMANDS=$OPTARG ;;
+        t) THREADS=$OPTARG ;;
+        r) REPETITIONS=$OPTARG ;;
+        *) sed -n '/^#  *\.\/bench.sh/,/^#  *\[-k/p' "$0" | sed 's/^# *//' >&2; exit 1 ;;
+    esac
+done
+
+MVOTE=../output/mvote
+make -s -C .. >/dev/null
+make -s Generate >/dev/null
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# The data: the voter file, and a sample of its pins for the l, m and bv commands
+./Generate -n "$VOTERS" -p "$PINS" -z "$ZIPCODES" -s "$SKEW" -o "$WORK/voters.csv"
+cut -d ' ' -f 1 "$WORK/voters.csv" | shuf -r -n "$COMMANDS" --random-source=<(yes) > "$WORK/pins.txt"
+
+# The command files: the runs in each pair differ only in the commands measured
+echo "exit" > "$WORK/load.txt"
+{ sed 's/^/l /' "$WORK/pins.txt"; echo "exit"; } > "$WORK/l.txt"
+{ sed 's/^/m /' "$WORK/pins.txt"; echo "exit"; } > "$WORK/m.txt"
+{ echo "bv $WORK/pins.txt quiet"; echo "exit"; } > "$WORK/bv.txt"
+{ echo "bv $WORK/pins.txt quiet"; yes "o" | head -n "$O_COMMANDS"; echo "exit"; } > "$WORK/o.txt"
+
+# Prints the least wall-clock time (ns) of mvote over every repetition, with the
+# commands of the file $1 and the options that follow
+best_run() {
+    local commands=$1 best="" start end
+    shift
+    for ((run = 0; run < REPETITIONS; run++)); do
+        start=$(date +%s%N)
+        "$MVOTE" -f "$WORK/voters.csv" -t "$THREADS" "$@" < "$commands" > /dev/null
+        end=$(date +%s%N)
+        if [[ -z $best || $((end - start)) -lt $best ]]; then
+            best=$((end - start))
+        fi
+    done
+    echo "$best"
+}
+
+# Prints $2 per the time (ns) $1, or - if the time is too short to tell
+per_second() {
+    if (( $1 > 0 )); then
+        echo $(( $2 * 1000000000 / $1 ))
+    else
+        echo "-"
+    fi
+}
+
+echo "voters: $VOTERS, pins: $PINS, zipcodes: $ZIPCODES (skew $SKEW), commands: $COMMANDS, threads: $THREADS"
+printf "%8s %8s %10s %10s %12s %12s %12s %10s\n" "-b" "-m" "-l" "load ms" "l /s" "m /s" "bv pins/s" "o ms"
+
+for b in $BUCKETS; do
+    for m in $SIZES; do
+        for l in $THRESHOLDS; do
+            options=(-b "$b" -m "$m" -l "$l")
+            load=$(best_run "$WORK/load.txt" "${options[@]}")
+            l_time=$(( $(best_run "$WORK/l.txt" "${options[@]}") - load ))
+            m_time=$(( $(best_run "$WORK/m.txt" "${options[@]}") - load ))
+            bv=$(best_run "$WORK/bv.txt" "${options[@]}")
+            o_time=$(( $(best_run "$WORK/o.txt" "${options[@]}") - bv ))
+            bv_time=$(( bv - load ))
+
+            printf "%8s %8s %10s %10s %12s %12s %12s %10s\n" "$b" "$m" "$l" \
+                "$(( load / 1000000 ))" \
+                "$(per_second "$l_time" "$COMMANDS")" \
+                "$(per_second "$m_time" "$COMMANDS")" \
+                "$(per_second "$bv_time" "$COMMANDS")" \
+                "$(awk -v t="$o_time" -v n="$O_COMMANDS" 'BEGIN { if (t > 0) printf "%.3f", t / n / 1e6; else printf "-" }')"
+        done
+    done
+done
@@ -0,0 +1,76 @@
+# Deletion (d): deleting most of the voters merges the buckets back and shrinks the
+# table, a deleted voter who had voted leaves the counters, and re-inserted pins
+# (in the slots the deleted voters left) are found again, as new voters
+"$MVOTE" -f "$TESTS/voters50.csv" -b 2 -m 2 <<'COMMANDS' | sed 's/([0-9.]* ms)/(T ms)/'
+m 100093
+m 100097
+m 100126
+v
+z 4010
+o
+stats
+d 100093
+d 100093
+d 100140
+d 100134
+d 100018
+d 100126
+d 100027
+d 100038
+d 100133
+d 100066
+d 100123
+d 100033
+d 100054
+d 100059
+d 100068
+d 100024
+d 100028
+d 100086
+d 100023
+d 100005
+d 100118
+d 100135
+d 100139
+d 100065
+d 100084
+d 100081
+d 100109
+d 100050
+d 100009
+d 100074
+d 100130
+d 100103
+d 100060
+d 100040
+d 100070
+d 100047
+d 100014
+d 100088
+d 100025
+d 100049
+d 100007
+v
+l 100093
+m 100093
+z 4010
+z 3996
+o
+perc
+stats
+i 100093 WIGGINS DEAN 4010
+i 100126 FRYE LOYD 3996
+i 100140 HEATH FLOYD 4010
+i 100097 DUPLICATE PIN 4010
+l 100093
+l 100140
+l 100097
+m 100093
+m 100140
+v
+z 4010
+z 3996
+o
+stats
+exit
+COMMANDS
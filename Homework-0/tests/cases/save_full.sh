@@ -0,0 +1,13 @@
+# A save to a full disk fails halfway, leaves no file behind, and the commands
+# go on: the snapshot is written to full.tmp first, which is made /dev/full here
+ln -s /dev/full full.tmp
+"$MVOTE" -f "$TESTS/voters5000.csv" -b 2 -m 2 <<'COMMANDS'
+save full
+l 100093
+m 100093
+save /nonexistent/directory/snapshot
+v
+save saved
+exit
+COMMANDS
+ls
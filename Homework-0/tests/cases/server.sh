@@ -0,0 +1,68 @@
+# The server (-S): the commands a client pipelines are answered in order, clients are
+# served at once, a line longer than the server accepts is answered as malformed (and
+# the connection goes on), and exit only closes the connection of its client. There
+# is no socat or nc to rely on, so the clients are written in Python
+"$MVOTE" -f "$TESTS/voters50.csv" -b 2 -m 2 -S mvote.sock > server.txt 2>&1 &
+server=$!
+for ((tries = 0; tries < 100; tries++)); do
+    [[ -S mvote.sock ]] && break
+    sleep 0.1
+done
+
+python3 - <<'CLIENTS'
+import socket
+
+def connect():
+    client = socket.socket(socket.AF_UNIX)
+    client.settimeout(10)
+    client.connect("mvote.sock")
+    return client
+
+# Reads the responses of n commands (every one of them is followed by an empty line)
+def responses(client, n):
+    data = b""
+    while data.count(b"\n\n") < n:
+        chunk = client.recv(65536)
+        if not chunk:
+            break
+        data += chunk
+    return data.decode()
+
+def show(title, text):
+    print("-- " + title)
+    print(text, end="")
+
+a = connect()
+a.sendall(b"l 100093\nm 100093\nl 100093\nv\nz 4010\n")
+show("pipelined", responses(a, 5))
+
+b = connect()
+a.sendall(b"m 100097\n")
+show("first client", responses(a, 1))
+b.sendall(b"v\nz 4010\n")
+show("second client", responses(b, 2))
+a.sendall(b"m 100081\n")
+b.sendall(b"m 100047\n")
+show("first client", responses(a, 1))
+show("second client", responses(b, 1))
+
+b.sendall(b"bv /" + b"a" * 1000 + b"\nv\n")
+show("overlong line", responses(b, 2))
+
+a.sendall(b"exit\n")
+show("exit", responses(a, 1))
+show("closed", "EOF\n" if a.recv(65536) == b"" else "still open\n")
+b.sendall(b"v\n")
+show("other client", responses(b, 1))
+c = connect()
+c.sendall(b"o\n")
+show("new client", responses(c, 1))
+CLIENTS
+
+kill -TERM $server
+wait $server
+echo "server exit status $?"
+cat server.txt
+if [[ -e mvote.sock ]]; then
+    echo "the socket was left behind"
+fi
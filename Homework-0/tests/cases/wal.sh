@@ -0,0 +1,85 @@
+# The write-ahead log (-w): it is replayed after a crash, the incomplete or corrupt
+# record a crash may leave at its end is dropped, it carries over a save, and it is
+# refused on top of a file other than the one it was logged on
+
+# Runs mvote with the options given, feeds it the commands of stdin and kills it
+# (as a crash would) once the log holds the record of the last one, which must
+# be an insertion of a voter surnamed LAST. Every record is committed at once (-c 1)
+crash() {
+    mkfifo commands
+    "$MVOTE" "$@" -c 1 < commands > /dev/null 2>&1 &
+    local pid=$!
+    cat > commands
+    for ((tries = 0; tries < 100; tries++)); do
+        grep -q LAST "$LOG" 2>/dev/null && break
+        sleep 0.1
+    done
+    kill -9 $pid
+    wait $pid 2>/dev/null
+    rm commands
+}
+
+# Runs mvote with the options given on the commands that check the state left by crash
+check() {
+    "$MVOTE" "$@" <<'COMMANDS'
+l 1
+l 2
+l 3
+l 100093
+l 100140
+l 100134
+v
+z 4010
+o
+exit
+COMMANDS
+    echo "status $?"
+}
+
+echo "== replay after a crash"
+LOG=log.wal
+crash -f "$TESTS/voters50.csv" -b 2 -m 2 -w log.wal <<'COMMANDS'
+i 1 FIRST VOTER 4010
+i 2 SECOND VOTER 4015
+m 1
+m 2
+m 100093
+m 100140
+d 100140
+d 2
+i 2 SECOND AGAIN 4006
+m 100134
+d 100134
+i 3 LAST VOTER 4010
+COMMANDS
+check -f "$TESTS/voters50.csv" -b 2 -m 2 -w log.wal
+
+echo "== a torn last record is dropped"
+printf '\x20\x00\x00\x00\x01' >> log.wal
+check -f "$TESTS/voters50.csv" -b 2 -m 2 -w log.wal
+
+echo "== a corrupt last record is dropped"
+printf '\x05\x00\x00\x00\x00\x00\x00\x00\x03\x01\x00\x00\x00' >> log.wal
+check -f "$TESTS/voters50.csv" -b 2 -m 2 -w log.wal
+
+echo "== replay on top of a snapshot"
+LOG=saved.wal
+crash -f "$TESTS/voters50.csv" -b 2 -m 2 -w saved.wal <<'COMMANDS'
+i 1 FIRST VOTER 4010
+m 1
+m 100093
+save snapshot
+i 2 SECOND VOTER 4015
+m 2
+m 100140
+d 100140
+d 100134
+i 3 LAST VOTER 4010
+COMMANDS
+check -f snapshot -b 2 -m 2 -w saved.wal
+
+echo "== a log is refused on top of another file"
+check -f "$TESTS/voters50.csv" -b 2 -m 2 -w saved.wal
+echo "exit" | "$MVOTE" -f "$TESTS/voters50.csv" -b 2 -m 2 -w stale.wal > /dev/null
+printf 'save newer\nexit\n' | "$MVOTE" -f "$TESTS/voters50.csv" -b 2 -m 2 > /dev/null
+check -f newer -b 2 -m 2 -w stale.wal
@@ -0,0 +1,58 @@
+#!/bin/bash
+#
+# ------------------------------ CHECK ------------------------------ #
+#
+# Runs every case of the cases directory and compares what it prints with the
+# expected output next to it (a case name.txt or name.sh is expected to print
+# name.out). A case is either:
+#
+#       name.txt : the commands of a single mvote run, initialized with voters50.csv
+#       name.sh  : a script, for what takes more than one run (restarts, clients of
+#                  the server, ...). It is run in an empty directory of its own, with
+#                  MVOTE (the program) and TESTS (this directory) set
+#
+# The count of bytes released at exit is left out of the comparison.
+#
+#       ./check.sh [<case> ...]
+#
+# Every case is run if none is given. Run it from the tests directory; mvote
+# is built first if it needs to be.
+
+export TESTS=$PWD
+export MVOTE=$TESTS/../output/mvote
+make -s -C .. >/dev/null || exit 1
+
+if (( $# == 0 )); then
+    shopt -s nullglob
+    set -- cases/*.txt cases/*.sh
+fi
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# Runs the case $1, and prints what it printed along with its exit status
+run_case() {
+    if [[ $1 == *.sh ]]; then
+        local dir
+        dir=$(mktemp -d -p "$WORK")
+        (cd "$dir" && bash "$TESTS/$1") 2>&1
+    else
+        "$MVOTE" -f voters50.csv -b 2 -m 2 < "$1" 2>&1
+    fi
+    echo "exit status $?"
+}
+
+failed=0
+for case in "$@"; do
+    expected=${case%.*}.out
+    actual=$(run_case "$case" | sed 's/[0-9]* of Bytes Released/N of Bytes Released/')
+    if diff <(echo "$actual") "$expected" > /dev/null; then
+        echo "ok      $case"
+    else
+        echo "FAILED  $case"
+        diff <(echo "$actual") "$expected"
+        failed=1
+    fi
+done
+
+exit $failed